@@ -0,0 +1,297 @@
+// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Linq;
+using System.Security.Cryptography;
+using System.Text;
+
+using Microsoft.Boogie;
+using Whoop.Domain.Drivers;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Houdini assignments that are kept across incremental runs, so that the next
+  /// run of an entry point can start from the assignment that the last run found.
+  ///
+  /// The candidate constants are renumbered whenever the driver changes, so each
+  /// candidate is identified by the contracts and invariants that it guards instead
+  /// of by its name.
+  ///
+  /// An assignment is only reused while the fingerprint of its entry point is
+  /// unchanged, as a candidate that was refuted before may hold after an edit.
+  /// </summary>
+  internal static class HoudiniInformation
+  {
+    #region fields
+
+    private static Dictionary<string, Dictionary<string, bool>> Assignments =
+      new Dictionary<string, Dictionary<string, bool>>();
+    private static Dictionary<string, string> Fingerprints =
+      new Dictionary<string, string>();
+
+    private static List<string> Files = null;
+    private static bool HasCurrentFingerprints = false;
+    private static object CurrentFingerprintsLock = new object();
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// Parses the assignments of the previous run, if there are any.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    public static void ParseAndInitialize(List<string> files)
+    {
+      string houdiniInfoFile = HoudiniInformation.GetFileName(files);
+      HoudiniInformation.Assignments = new Dictionary<string, Dictionary<string, bool>>();
+      HoudiniInformation.Fingerprints = new Dictionary<string, string>();
+      HoudiniInformation.Files = files;
+      HoudiniInformation.HasCurrentFingerprints = false;
+
+      if (!File.Exists(houdiniInfoFile))
+        return;
+
+      using(StreamReader file = new StreamReader(houdiniInfoFile))
+      {
+        string line;
+
+        while ((line = file.ReadLine()) != null)
+        {
+          string[] info = line.Split(new string[] { "::" }, StringSplitOptions.None);
+          if (info.Length == 2)
+            HoudiniInformation.Fingerprints[info[0]] = info[1];
+          if (info.Length != 3)
+            continue;
+
+          if (!HoudiniInformation.Assignments.ContainsKey(info[0]))
+            HoudiniInformation.Assignments.Add(info[0], new Dictionary<string, bool>());
+          HoudiniInformation.Assignments[info[0]][info[1]] = info[2].Equals("1");
+        }
+      }
+    }
+
+    /// <summary>
+    /// Computes the initial Houdini assignment of the given entry point. Candidates
+    /// that the last run refuted start as false, so Houdini does not have to refute
+    /// them again. All other candidates start as true. If the entry point has changed
+    /// since the last run, all candidates start as true.
+    ///
+    /// A candidate that was refuted last time may now hold, and is then lost, but
+    /// this only makes the summary weaker and never unsound, as Houdini still checks
+    /// every candidate that it keeps.
+    /// </summary>
+    /// <returns>Initial assignment, or null if there is nothing to start from</returns>
+    /// <param name="program">Program of the entry point</param>
+    /// <param name="ep">Entry point</param>
+    public static Dictionary<string, bool> GetInitialAssignment(Microsoft.Boogie.Program program, EntryPoint ep)
+    {
+      Contract.Requires(program != null && ep != null);
+
+      Dictionary<string, bool> stored = null;
+      string fingerprint = HoudiniInformation.GetCurrentFingerprint(ep);
+      lock (HoudiniInformation.Assignments)
+      {
+        string storedFingerprint = null;
+        if (fingerprint == null ||
+            !HoudiniInformation.Fingerprints.TryGetValue(ep.Name, out storedFingerprint) ||
+            !storedFingerprint.Equals(fingerprint))
+          return null;
+        if (!HoudiniInformation.Assignments.TryGetValue(ep.Name, out stored))
+          return null;
+      }
+
+      var identities = HoudiniInformation.ComputeIdentities(program);
+      var assignment = new Dictionary<string, bool>();
+
+      foreach (var candidate in HoudiniInformation.GetCandidates(program))
+      {
+        string identity = null;
+        bool value = false;
+        assignment[candidate.Name] = !identities.TryGetValue(candidate.Name, out identity) ||
+          !stored.TryGetValue(identity, out value) || value;
+      }
+
+      return assignment;
+    }
+
+    /// <summary>
+    /// Stores the Houdini assignment that was found for the given entry point,
+    /// replacing the one from the previous run.
+    /// </summary>
+    /// <param name="program">Program of the entry point</param>
+    /// <param name="ep">Entry point</param>
+    /// <param name="assignment">Houdini assignment</param>
+    public static void RegisterAssignment(Microsoft.Boogie.Program program, EntryPoint ep,
+      Dictionary<string, bool> assignment)
+    {
+      Contract.Requires(program != null && ep != null && assignment != null);
+
+      var identities = HoudiniInformation.ComputeIdentities(program);
+      var stored = new Dictionary<string, bool>();
+
+      foreach (var candidate in assignment)
+      {
+        string identity = null;
+        if (!identities.TryGetValue(candidate.Key, out identity))
+          continue;
+
+        // Candidates with the same identity hold together, so one refutation is enough
+        bool value = false;
+        stored[identity] = candidate.Value && (!stored.TryGetValue(identity, out value) || value);
+      }
+
+      string fingerprint = HoudiniInformation.GetCurrentFingerprint(ep);
+      lock (HoudiniInformation.Assignments)
+      {
+        HoudiniInformation.Assignments[ep.Name] = stored;
+        if (fingerprint != null)
+          HoudiniInformation.Fingerprints[ep.Name] = fingerprint;
+        else
+          HoudiniInformation.Fingerprints.Remove(ep.Name);
+      }
+    }
+
+    /// <summary>
+    /// Prints the stored Houdini assignments.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    public static void ToFile(List<string> files)
+    {
+      lock (HoudiniInformation.Assignments)
+      {
+        using(StreamWriter file = new StreamWriter(HoudiniInformation.GetFileName(files)))
+        {
+          foreach (var ep in HoudiniInformation.Assignments)
+          {
+            string fingerprint = null;
+            if (HoudiniInformation.Fingerprints.TryGetValue(ep.Key, out fingerprint))
+              file.WriteLine(ep.Key + "::" + fingerprint);
+            foreach (var candidate in ep.Value)
+              file.WriteLine(ep.Key + "::" + candidate.Key + "::" + (candidate.Value ? "1" : "0"));
+          }
+        }
+      }
+    }
+
+    #endregion
+
+    #region other methods
+
+    /// <summary>
+    /// Returns the fingerprint that the engine has computed for the given entry point
+    /// in this run. The fingerprints are read on first use, as the engine writes them
+    /// after the cruncher has started when the tools run as a pipeline.
+    /// </summary>
+    /// <returns>Fingerprint, or null if there is none</returns>
+    /// <param name="ep">Entry point</param>
+    private static string GetCurrentFingerprint(EntryPoint ep)
+    {
+      lock (HoudiniInformation.CurrentFingerprintsLock)
+      {
+        if (HoudiniInformation.Files == null)
+          return null;
+        if (!HoudiniInformation.HasCurrentFingerprints)
+        {
+          IncrementalInformation.ParseAndInitialize(HoudiniInformation.Files);
+          HoudiniInformation.HasCurrentFingerprints = true;
+        }
+
+        return IncrementalInformation.GetFingerprint(ep);
+      }
+    }
+
+    private static string GetFileName(List<string> files)
+    {
+      return files[files.Count - 1].Substring(0,
+        files[files.Count - 1].LastIndexOf(".")) + ".houdini.info";
+    }
+
+    private static List<Constant> GetCandidates(Microsoft.Boogie.Program program)
+    {
+      return program.TopLevelDeclarations.OfType<Constant>().Where(val =>
+        QKeyValue.FindBoolAttribute(val.Attributes, "existential")).ToList();
+    }
+
+    /// <summary>
+    /// Identifies each candidate by the expressions that it guards, together with
+    /// the procedure and the kind of contract or invariant that they appear in.
+    /// </summary>
+    /// <returns>Map from candidate names to identities</returns>
+    /// <param name="program">Program</param>
+    private static Dictionary<string, string> ComputeIdentities(Microsoft.Boogie.Program program)
+    {
+      var candidates = new HashSet<string>(HoudiniInformation.GetCandidates(program).Select(val => val.Name));
+      var guarded = new Dictionary<string, List<string>>();
+
+      foreach (var proc in program.TopLevelDeclarations.OfType<Procedure>())
+      {
+        foreach (var req in proc.Requires)
+          HoudiniInformation.AddGuarded(guarded, candidates, req.Condition, proc.Name + "::requires");
+        foreach (var ens in proc.Ensures)
+          HoudiniInformation.AddGuarded(guarded, candidates, ens.Condition, proc.Name + "::ensures");
+      }
+
+      foreach (var impl in program.TopLevelDeclarations.OfType<Implementation>())
+      {
+        foreach (var cmd in impl.Blocks.SelectMany(val => val.Cmds).OfType<PredicateCmd>())
+        {
+          HoudiniInformation.AddGuarded(guarded, candidates, cmd.Expr, impl.Name + "::" +
+            (cmd is AssertCmd ? "assert" : "assume"));
+        }
+      }
+
+      var identities = new Dictionary<string, string>();
+      foreach (var candidate in guarded)
+      {
+        candidate.Value.Sort(StringComparer.Ordinal);
+        identities.Add(candidate.Key, HoudiniInformation.ComputeHash(
+          string.Join("\n", candidate.Value)));
+      }
+
+      return identities;
+    }
+
+    private static void AddGuarded(Dictionary<string, List<string>> guarded, HashSet<string> candidates,
+      Expr expr, string context)
+    {
+      var imp = expr as NAryExpr;
+      if (imp == null || !(imp.Fun is BinaryOperator) ||
+          (imp.Fun as BinaryOperator).Op != BinaryOperator.Opcode.Imp ||
+          !(imp.Args[0] is IdentifierExpr))
+        return;
+
+      var name = (imp.Args[0] as IdentifierExpr).Name;
+      if (!candidates.Contains(name))
+        return;
+
+      if (!guarded.ContainsKey(name))
+        guarded.Add(name, new List<string>());
+      guarded[name].Add(context + "::" + imp.Args[1].ToString());
+    }
+
+    private static string ComputeHash(string text)
+    {
+      using (var sha = SHA1.Create())
+      {
+        var hash = sha.ComputeHash(Encoding.UTF8.GetBytes(text));
+        return BitConverter.ToString(hash).Replace("-", "").ToLower();
+      }
+    }
+
+    #endregion
+  }
+}
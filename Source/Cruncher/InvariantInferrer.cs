@@ -9,7 +9,7 @@
 //
 // ===----------------------------------------------------------------------===//
 
-﻿using System;
+using System;
 using System.Diagnostics.Contracts;
 using System.IO;
 using System.Collections.Generic;
@@ -90,9 +90,16 @@ namespace Whoop
 
     private void PerformHoudini(ref HoudiniOutcome outcome)
     {
+      Dictionary<string, bool> initialAssignment = null;
+      if (WhoopCruncherCommandLineOptions.Get().Incremental)
+        initialAssignment = HoudiniInformation.GetInitialAssignment(this.AC.Program, this.EP);
+
       var houdiniStats = new HoudiniSession.HoudiniStatistics();
       this.Houdini = new Houdini(this.AC.Program, houdiniStats);
-      outcome = this.Houdini.PerformHoudiniInference();
+      outcome = this.Houdini.PerformHoudiniInference(initialAssignment: initialAssignment);
+
+      if (WhoopCruncherCommandLineOptions.Get().Incremental)
+        HoudiniInformation.RegisterAssignment(this.AC.Program, this.EP, outcome.assignment);
 
       if (CommandLineOptions.Clo.PrintAssignment)
       {
@@ -130,7 +137,6 @@ namespace Whoop
         Houdini.ApplyAssignment(this.PostAC.Program, outcome);
 //         this.Houdini.ApplyAssignment(this.PostAC.Program);
         this.Houdini.Close();
-        WhoopCruncherCommandLineOptions.Get().TheProverFactory.Close();
       }
     }
 
@@ -11,8 +11,10 @@
 
 using System;
 using System.IO;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics.Contracts;
+using System.Threading.Tasks;
 
 using Microsoft.Boogie;
 using Whoop.Domain.Drivers;
@@ -21,7 +23,22 @@ namespace Whoop
 {
   public class Program
   {
+    private static object ParserLock = new object();
+    private static Whoop.IO.PipelineChannel Channel = null;
+
     public static void Main(string[] args)
+    {
+      Contract.Requires(cce.NonNullElements(args));
+      Environment.Exit(Program.Run(args));
+    }
+
+    /// <summary>
+    /// Runs the tool with the given arguments. This is kept separate from Main,
+    /// so that the Whoop daemon can run the tool inside its own process.
+    /// </summary>
+    /// <returns>Exit code</returns>
+    /// <param name="args">Arguments</param>
+    public static int Run(string[] args)
     {
       Contract.Requires(cce.NonNullElements(args));
 
@@ -34,13 +51,13 @@ namespace Whoop
 
         if (!WhoopCruncherCommandLineOptions.Get().Parse(args))
         {
-          Environment.Exit((int)Outcome.FatalError);
+          return (int)Outcome.FatalError;
         }
 
         if (WhoopCruncherCommandLineOptions.Get().Files.Count == 0)
         {
           Whoop.IO.Reporter.ErrorWriteLine("Whoop: error: no input files were specified");
-          Environment.Exit((int)Outcome.FatalError);
+          return (int)Outcome.FatalError;
         }
 
         List<string> fileList = new List<string>();
@@ -66,14 +83,26 @@ namespace Whoop
           if (extension != ".bpl")
           {
             Whoop.IO.Reporter.ErrorWriteLine("Whoop: error: {0} is not a .bpl file", file);
-            Environment.Exit((int)Outcome.FatalError);
+            return (int)Outcome.FatalError;
           }
         }
 
         DeviceDriver.ParseAndInitialize(fileList);
-        Summarisation.SummaryInformationParser.FromFile(fileList);
+        if (WhoopCruncherCommandLineOptions.Get().Incremental)
+          HoudiniInformation.ParseAndInitialize(fileList);
         ExecutionTimer timer = null;
 
+        Program.Channel = null;
+        if (WhoopCruncherCommandLineOptions.Get().Pipeline)
+        {
+          Program.Channel = new Whoop.IO.PipelineChannel(fileList, "cruncher");
+          Program.Channel.Create();
+        }
+        else
+        {
+          Summarisation.SummaryInformationParser.FromFile(fileList);
+        }
+
         if (WhoopCruncherCommandLineOptions.Get().MeasurePassExecutionTime)
         {
           Console.WriteLine("\n[Cruncher] runtime");
@@ -82,25 +111,58 @@ namespace Whoop
           timer.Start();
         }
 
-        var alreadyCrunched = new HashSet<string>();
-        foreach (var ep in DeviceDriver.EntryPoints)
+        IEnumerable<EntryPoint> entryPoints = null;
+        if (WhoopCruncherCommandLineOptions.Get().Pipeline)
+          entryPoints = Program.ReceiveEntryPoints(fileList);
+        else
+          entryPoints = Program.GetEntryPointsWithSummaries();
+
+        if (WhoopCruncherCommandLineOptions.Get().ParallelEntryPoints > 1)
         {
-          if (!Summarisation.SummaryInformationParser.AvailableSummaries.Contains(ep.Name))
-            continue;
-          if (alreadyCrunched.Contains(ep.Name))
-            continue;
+          var outputs = new ConcurrentDictionary<EntryPoint, Tuple<string, string>>();
+          var options = new ParallelOptions {
+            MaxDegreeOfParallelism = WhoopCruncherCommandLineOptions.Get().ParallelEntryPoints,
+            CancellationToken = ToolState.Cancellation
+          };
 
-          AnalysisContext ac = null;
-          AnalysisContext acPost = null;
-          new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl").TryParseNew(
-            ref ac, new List<string> { ep.Name + "$instrumented" });
-          new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl").TryParseNew(
-            ref acPost, new List<string> { ep.Name + "$instrumented" });
-          new InvariantInferrer(ac, acPost, ep).Run();
+          // The entry points may still be arriving from the engine, so they are
+          // handed out one at a time instead of in chunks
+          Whoop.IO.ConsoleCapture.Install();
+          Parallel.ForEach(Partitioner.Create(entryPoints, EnumerablePartitionerOptions.NoBuffering),
+            options, ep => {
+            Whoop.IO.ConsoleCapture.Begin();
+            try
+            {
+              Program.CrunchEntryPoint(ep, fileList);
+            }
+            finally
+            {
+              outputs[ep] = Whoop.IO.ConsoleCapture.End();
+            }
+          });
 
-          alreadyCrunched.Add(ep.Name);
+          foreach (var ep in DeviceDriver.EntryPoints)
+          {
+            Tuple<string, string> output = null;
+            if (outputs.TryRemove(ep, out output))
+              Whoop.IO.ConsoleCapture.Replay(output);
+          }
+        }
+        else
+        {
+          foreach (var ep in entryPoints)
+          {
+            ToolState.Cancellation.ThrowIfCancellationRequested();
+            Program.CrunchEntryPoint(ep, fileList);
+          }
         }
 
+        WhoopCruncherCommandLineOptions.Get().TheProverFactory.Close();
+        if (WhoopCruncherCommandLineOptions.Get().Incremental)
+          HoudiniInformation.ToFile(fileList);
+        if (Program.Channel != null)
+          Program.Channel.Close();
+
         if (WhoopCruncherCommandLineOptions.Get().MeasurePassExecutionTime)
         {
           timer.Stop();
@@ -108,13 +170,97 @@ namespace Whoop
           Console.WriteLine(" |--- [Total] {0}", timer.Result());
         }
 
-        Environment.Exit((int)Outcome.Done);
+        return (int)Outcome.Done;
       }
       catch (Exception e)
       {
+        var fatal = OutcomeException.Find(e);
+        if (fatal != null)
+        {
+          Whoop.IO.Reporter.ErrorWriteLine(fatal.Message);
+          return (int)fatal.Outcome;
+        }
+
         Console.Error.Write("Exception thrown in Whoop: ");
         Console.Error.WriteLine(e);
-        Environment.Exit((int)Outcome.FatalError);
+        return (int)Outcome.FatalError;
+      }
+    }
+
+    /// <summary>
+    /// Infers the summary of the given entry point. Each call runs its own Houdini
+    /// instance, which starts a fresh prover and closes it when done. Provers are
+    /// not pooled, as Houdini cannot be given a prover to use.
+    /// </summary>
+    /// <param name="ep">Entry point</param>
+    /// <param name="fileList">File list</param>
+    private static void CrunchEntryPoint(EntryPoint ep, List<string> fileList)
+    {
+      AnalysisContext ac = null;
+      AnalysisContext acPost = null;
+
+      // Parsing and type checking use shared Boogie state, so they are not run
+      // concurrently.
+      lock (Program.ParserLock)
+      {
+        var parser = new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl");
+        parser.TryDuplicateNew(ref ac, new List<string> { ep.Name + "$instrumented" });
+        parser.TryDuplicateNew(ref acPost, new List<string> { ep.Name + "$instrumented" });
+      }
+
+      new InvariantInferrer(ac, acPost, ep).Run();
+
+      if (Program.Channel != null)
+        Program.Channel.Announce("entrypoint::" + ep.Name);
+    }
+
+    /// <summary>
+    /// Returns the entry points that the engine generated summaries for.
+    /// </summary>
+    /// <returns>Entry points</returns>
+    private static List<EntryPoint> GetEntryPointsWithSummaries()
+    {
+      var entryPoints = new List<EntryPoint>();
+      var alreadyCrunched = new HashSet<string>();
+      foreach (var ep in DeviceDriver.EntryPoints)
+      {
+        if (!Summarisation.SummaryInformationParser.AvailableSummaries.Contains(ep.Name))
+          continue;
+        if (alreadyCrunched.Contains(ep.Name))
+          continue;
+
+        entryPoints.Add(ep);
+        alreadyCrunched.Add(ep.Name);
+      }
+
+      return entryPoints;
+    }
+
+    /// <summary>
+    /// Returns the entry points with summaries as the engine announces them, so
+    /// that they can be crunched while the engine is still running.
+    /// </summary>
+    /// <returns>Entry points</returns>
+    /// <param name="fileList">File list</param>
+    private static IEnumerable<EntryPoint> ReceiveEntryPoints(List<string> fileList)
+    {
+      var engine = new Whoop.IO.PipelineChannel(fileList, "engine");
+      var alreadyCrunched = new HashSet<string>();
+
+      List<string> artifacts = null;
+      while ((artifacts = engine.Receive()) != null)
+      {
+        foreach (var artifact in artifacts)
+        {
+          var tokens = artifact.Split(new string[] { "::" }, StringSplitOptions.None);
+          if (tokens.Length != 3 || !tokens[0].Equals("entrypoint") || !tokens[2].Equals("summarised"))
+            continue;
+          if (alreadyCrunched.Contains(tokens[1]))
+            continue;
+
+          alreadyCrunched.Add(tokens[1]);
+          yield return DeviceDriver.GetEntryPoint(tokens[1]);
+        }
       }
     }
   }
@@ -16,6 +16,8 @@ namespace Whoop
 {
   internal class WhoopCruncherCommandLineOptions : WhoopCommandLineOptions
   {
+    public int ParallelEntryPoints = 1;
+
     public WhoopCruncherCommandLineOptions()
       : base("Whoop", "Whoop static lockset analyser")
     {
@@ -24,6 +26,15 @@ namespace Whoop
 
     protected override bool ParseOption(string option, CommandLineOptionEngine.CommandLineParseState ps)
     {
+      if (option == "parallelEntryPoints")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.ParallelEntryPoints = Int32.Parse(ps.args[ps.i]);
+        }
+        return true;
+      }
+
       return base.ParseOption(option, ps);
     }
 
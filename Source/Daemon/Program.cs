@@ -0,0 +1,293 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Net.Sockets;
+using System.Reflection;
+using System.Text;
+using System.Threading;
+
+using Mono.Unix;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Long running process that keeps the Whoop tools loaded and jitted, and runs
+  /// the jobs that it receives over a Unix domain socket. This avoids paying the
+  /// start up cost of the runtime and of Boogie for every tool invocation.
+  ///
+  /// A request consists of the tool name, the working directory, the number of
+  /// arguments and then the arguments, each on its own line. The reply consists
+  /// of the exit code on its own line followed by the output of the job.
+  ///
+  /// Jobs run one at a time, as the tools keep static state. A job whose client
+  /// has gone away, for example because it timed out, is dropped if it has not
+  /// started yet, and cancelled if it is running, so that it does not hold up the
+  /// jobs of later clients.
+  /// </summary>
+  public class Program
+  {
+    private static Dictionary<string, MethodInfo> Tools;
+    private static object JobLock = new object();
+
+    /// <summary>
+    /// How often the client of a running job is checked, in milliseconds.
+    /// </summary>
+    private const int ClientCheckInterval = 500;
+
+    public static void Main(string[] args)
+    {
+      Contract.Requires(args != null);
+
+      var directory = Path.GetDirectoryName(Assembly.GetExecutingAssembly().Location);
+      var socketFile = args.Length > 0 ? args[0] : Path.Combine(directory, "WhoopDaemon.sock");
+
+      Program.Tools = new Dictionary<string, MethodInfo>();
+      Program.LoadTool("engine", Path.Combine(directory, "WhoopEngine.exe"));
+      Program.LoadTool("cruncher", Path.Combine(directory, "WhoopCruncher.exe"));
+      Program.LoadTool("raceChecker", Path.Combine(directory, "WhoopRaceChecker.exe"));
+
+      if (File.Exists(socketFile))
+        File.Delete(socketFile);
+
+      using (var listener = new Socket(AddressFamily.Unix, SocketType.Stream, ProtocolType.IP))
+      {
+        listener.Bind(new UnixEndPoint(socketFile));
+        listener.Listen(16);
+        Console.WriteLine("Whoop daemon: listening on " + socketFile);
+
+        var jobs = new List<Thread>();
+
+        try
+        {
+          while (true)
+          {
+            var client = listener.Accept();
+            var job = Program.ReadRequest(client);
+            if (job == null)
+            {
+              client.Close();
+              continue;
+            }
+
+            if (job.Tool.Equals("shutdown"))
+            {
+              client.Close();
+              break;
+            }
+
+            // Requests keep being accepted while a job runs, so that the daemon
+            // notices when the clients of waiting jobs go away
+            var thread = new Thread(() => Program.ServeRequest(job));
+            thread.Start();
+            jobs.RemoveAll(val => !val.IsAlive);
+            jobs.Add(thread);
+          }
+
+          foreach (var thread in jobs)
+            thread.Join();
+        }
+        finally
+        {
+          File.Delete(socketFile);
+        }
+      }
+    }
+
+    /// <summary>
+    /// Reads a request from the given client.
+    /// </summary>
+    /// <returns>Job, or null if the request is empty or malformed</returns>
+    /// <param name="client">Client</param>
+    private static Job ReadRequest(Socket client)
+    {
+      try
+      {
+        var reader = new StreamReader(new NetworkStream(client), new UTF8Encoding(false));
+        var tool = reader.ReadLine();
+        if (tool == null)
+          return null;
+        if (tool.Equals("shutdown"))
+          return new Job(client, tool, null, null);
+
+        var directory = reader.ReadLine();
+        var args = new string[Int32.Parse(reader.ReadLine())];
+        for (int idx = 0; idx < args.Length; idx++)
+          args[idx] = reader.ReadLine();
+
+        return new Job(client, tool, directory, args);
+      }
+      catch (IOException)
+      {
+        // The client went away; there is nobody to report to
+      }
+      catch (FormatException)
+      {
+        Console.Error.WriteLine("Whoop daemon: ignoring malformed request");
+      }
+      catch (OverflowException)
+      {
+        Console.Error.WriteLine("Whoop daemon: ignoring malformed request");
+      }
+
+      return null;
+    }
+
+    /// <summary>
+    /// Runs the given job once no other job is running, and writes back the reply.
+    /// The job is dropped if its client goes away before it starts, and cancelled
+    /// if its client goes away while it runs.
+    /// </summary>
+    /// <param name="job">Job</param>
+    private static void ServeRequest(Job job)
+    {
+      try
+      {
+        lock (Program.JobLock)
+        {
+          if (!Program.IsConnected(job.Client))
+            return;
+
+          var output = new StringWriter();
+          var cancellation = new CancellationTokenSource();
+
+          int exitCode;
+          using (new Timer(state => {
+            if (!Program.IsConnected(job.Client))
+              cancellation.Cancel();
+          }, null, Program.ClientCheckInterval, Program.ClientCheckInterval))
+          {
+            exitCode = Program.RunJob(job, cancellation.Token, output);
+          }
+
+          if (cancellation.IsCancellationRequested)
+            return;
+
+          var writer = new StreamWriter(new NetworkStream(job.Client), new UTF8Encoding(false));
+          writer.Write(exitCode + "\n");
+          writer.Write(output.ToString());
+          writer.Flush();
+        }
+      }
+      catch (IOException)
+      {
+        // The client went away; there is nobody to report to
+      }
+      catch (SocketException)
+      {
+        // The client went away; there is nobody to report to
+      }
+      finally
+      {
+        job.Client.Close();
+      }
+    }
+
+    /// <summary>
+    /// Runs the given job, writing its console output into the given writer.
+    /// </summary>
+    /// <returns>Exit code</returns>
+    /// <param name="job">Job</param>
+    /// <param name="cancellation">Cancellation token</param>
+    /// <param name="output">Output</param>
+    private static int RunJob(Job job, CancellationToken cancellation, TextWriter output)
+    {
+      MethodInfo run = null;
+      if (!Program.Tools.TryGetValue(job.Tool, out run))
+      {
+        output.WriteLine("Whoop daemon: error: unknown tool '" + job.Tool + "'");
+        return (int)Outcome.FatalError;
+      }
+
+      var stdOut = Console.Out;
+      var stdErr = Console.Error;
+      var currentDirectory = Directory.GetCurrentDirectory();
+
+      try
+      {
+        Console.SetOut(output);
+        Console.SetError(output);
+        Directory.SetCurrentDirectory(job.Directory);
+        ToolState.Reset(cancellation);
+
+        return (int)run.Invoke(null, new object[] { job.Arguments });
+      }
+      catch (TargetInvocationException e)
+      {
+        output.WriteLine("Whoop daemon: " + job.Tool + " failed: " + e.InnerException.Message);
+        return (int)Outcome.FatalError;
+      }
+      catch (Exception e)
+      {
+        output.WriteLine("Whoop daemon: error: " + e.Message);
+        return (int)Outcome.FatalError;
+      }
+      finally
+      {
+        Console.Out.Flush();
+        Console.SetOut(stdOut);
+        Console.SetError(stdErr);
+        Directory.SetCurrentDirectory(currentDirectory);
+      }
+    }
+
+    /// <summary>
+    /// Checks if the given client is still connected. The client sends nothing
+    /// after its request, so a readable socket without data means that the client
+    /// has closed it.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="client">Client</param>
+    private static bool IsConnected(Socket client)
+    {
+      try
+      {
+        return !(client.Poll(0, SelectMode.SelectRead) && client.Available == 0);
+      }
+      catch (SocketException)
+      {
+        return false;
+      }
+      catch (ObjectDisposedException)
+      {
+        return false;
+      }
+    }
+
+    private static void LoadTool(string name, string file)
+    {
+      var type = Assembly.LoadFrom(file).GetType("Whoop.Program", true);
+      Program.Tools.Add(name, type.GetMethod("Run", new Type[] { typeof(string[]) }));
+    }
+
+    /// <summary>
+    /// A request of a client to run a tool.
+    /// </summary>
+    private sealed class Job
+    {
+      public readonly Socket Client;
+      public readonly string Tool;
+      public readonly string Directory;
+      public readonly string[] Arguments;
+
+      public Job(Socket client, string tool, string directory, string[] args)
+      {
+        this.Client = client;
+        this.Tool = tool;
+        this.Directory = directory;
+        this.Arguments = args;
+      }
+    }
+  }
+}
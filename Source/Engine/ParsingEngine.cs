@@ -25,8 +25,6 @@ namespace Whoop
     private EntryPoint EP;
     private ExecutionTimer Timer;
 
-    private static HashSet<string> AlreadyParsed = new HashSet<string>();
-
     public ParsingEngine(AnalysisContext ac, EntryPoint ep)
     {
       Contract.Requires(ac != null && ep != null);
@@ -36,7 +34,7 @@ namespace Whoop
 
     public void Run()
     {
-      if (ParsingEngine.AlreadyParsed.Contains(this.EP.Name))
+      if (AnalysisSession.Current.IsParsed(this.EP.Name))
         return;
 
       if (WhoopEngineCommandLineOptions.Get().MeasurePassExecutionTime)
@@ -66,7 +64,7 @@ namespace Whoop
       Whoop.IO.BoogieProgramEmitter.Emit(this.AC.TopLevelDeclarations, WhoopEngineCommandLineOptions.Get().Files[
         WhoopEngineCommandLineOptions.Get().Files.Count - 1], this.EP.Name, "wbpl");
 
-      ParsingEngine.AlreadyParsed.Add(this.EP.Name);
+      AnalysisSession.Current.MarkAsParsed(this.EP.Name);
     }
   }
 }
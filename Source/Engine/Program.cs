@@ -13,6 +13,7 @@ using System;
 using System.IO;
 using System.Collections.Generic;
 using System.Diagnostics.Contracts;
+using System.Threading.Tasks;
 
 using Microsoft.Boogie;
 using Whoop.Domain.Drivers;
@@ -25,12 +26,27 @@ namespace Whoop
   {
     private static List<string> FileList = new List<string>();
     private static ExecutionTimer Timer = null;
+    private static Whoop.IO.PipelineChannel Channel = null;
+    private static object ParserLock = new object();
 
     public static void Main(string[] args)
+    {
+      Contract.Requires(cce.NonNullElements(args));
+      Environment.Exit(Program.Run(args));
+    }
+
+    /// <summary>
+    /// Runs the tool with the given arguments. This is kept separate from Main,
+    /// so that the Whoop daemon can run the tool inside its own process.
+    /// </summary>
+    /// <returns>Exit code</returns>
+    /// <param name="args">Arguments</param>
+    public static int Run(string[] args)
     {
       Contract.Requires(cce.NonNullElements(args));
 
       CommandLineOptions.Install(new WhoopEngineCommandLineOptions());
+      Program.FileList = new List<string>();
 
       try
       {
@@ -39,13 +55,15 @@ namespace Whoop
 
         if (!WhoopEngineCommandLineOptions.Get().Parse(args))
         {
-          Environment.Exit((int)Outcome.FatalError);
+          return (int)Outcome.FatalError;
         }
 
+        WhoopEngineCommandLineOptions.Get().Arguments = args;
+
         if (WhoopEngineCommandLineOptions.Get().Files.Count == 0)
         {
           Whoop.IO.Reporter.ErrorWriteLine("Whoop: error: no input files were specified");
-          Environment.Exit((int)Outcome.FatalError);
+          return (int)Outcome.FatalError;
         }
 
         foreach (string file in WhoopEngineCommandLineOptions.Get().Files)
@@ -69,12 +87,21 @@ namespace Whoop
           if (extension != ".bpl")
           {
             Whoop.IO.Reporter.ErrorWriteLine("Whoop: error: {0} is not a .bpl file", file);
-            Environment.Exit((int)Outcome.FatalError);
+            return (int)Outcome.FatalError;
           }
         }
 
         DeviceDriver.ParseAndInitialize(Program.FileList);
         FunctionPointerInformation.ParseAndInitialize(Program.FileList);
+        if (WhoopEngineCommandLineOptions.Get().Incremental)
+          IncrementalInformation.ParseAndInitialize(Program.FileList);
+
+        Program.Channel = null;
+        if (WhoopEngineCommandLineOptions.Get().Pipeline)
+        {
+          Program.Channel = new Whoop.IO.PipelineChannel(Program.FileList, "engine");
+          Program.Channel.Create();
+        }
 
         if (WhoopEngineCommandLineOptions.Get().PrintPairs)
         {
@@ -86,13 +113,23 @@ namespace Whoop
         Program.RunSummaryGenerationEngine();
         Program.RunPairWiseCheckingInstrumentationEngine();
 
-        Environment.Exit((int)Outcome.Done);
+        if (Program.Channel != null)
+          Program.Channel.Close();
+
+        return (int)Outcome.Done;
       }
       catch (Exception e)
       {
+        var fatal = OutcomeException.Find(e);
+        if (fatal != null)
+        {
+          Whoop.IO.Reporter.ErrorWriteLine(fatal.Message);
+          return (int)fatal.Outcome;
+        }
+
         Console.Error.Write("Exception thrown in Whoop: ");
         Console.Error.WriteLine(e);
-        Environment.Exit((int)Outcome.FatalError);
+        return (int)Outcome.FatalError;
       }
     }
 
@@ -110,14 +147,21 @@ namespace Whoop
       Whoop.IO.BoogieProgramEmitter.Emit(programAC.TopLevelDeclarations, WhoopEngineCommandLineOptions.Get().Files[
         WhoopEngineCommandLineOptions.Get().Files.Count - 1],"wbpl");
 
+      var parser = new AnalysisContextParser(Program.FileList[Program.FileList.Count - 1], "wbpl");
       foreach (var ep in DeviceDriver.EntryPoints)
       {
         AnalysisContext ac = null;
-        new AnalysisContextParser(Program.FileList[Program.FileList.Count - 1],
-          "wbpl").TryParseNew(ref ac);
+        parser.TryDuplicateNew(ref ac);
         new ParsingEngine(ac, ep).Run();
       }
 
+      if (WhoopEngineCommandLineOptions.Get().Incremental)
+      {
+        IncrementalInformation.ComputeFingerprints(programAC);
+        IncrementalInformation.ToFile(Program.FileList);
+      }
+
+      Program.Announce("parsed");
       Program.StopTimer();
     }
 
@@ -125,21 +169,32 @@ namespace Whoop
     {
       Program.StartTimer("StaticLocksetAnalysisInstrumentationEngine");
 
-      foreach (var ep in DeviceDriver.EntryPoints)
-      {
+      Program.ForEach(DeviceDriver.EntryPoints, ep => {
         AnalysisContext ac = null;
-        new AnalysisContextParser(Program.FileList[Program.FileList.Count - 1], "wbpl").TryParseNew(
-          ref ac, new List<string> { ep.Name });
+
+        // Parsing and type checking use shared Boogie state, so they are not run
+        // concurrently.
+        lock (Program.ParserLock)
+        {
+          new AnalysisContextParser(Program.FileList[Program.FileList.Count - 1], "wbpl").TryParseNew(
+            ref ac, new List<string> { ep.Name });
+        }
 
         Analysis.SharedStateAnalyser.AnalyseMemoryRegions(ac, ep);
         AnalysisContext.RegisterEntryPointAnalysisContext(ac, ep);
-      }
+      });
 
-      foreach (var ep in DeviceDriver.EntryPoints)
-      {
+      Program.PruneEntryPointPairs();
+
+      // The memory regions of all entry points must be known before pruning them
+      // with the pair information, so the instrumentation starts only after the
+      // above has finished.
+      Program.ForEach(DeviceDriver.EntryPoints, ep => {
         var ac = AnalysisContext.GetAnalysisContext(ep);
         new StaticLocksetAnalysisInstrumentationEngine(ac, ep).Run();
-      }
+        if (WhoopEngineCommandLineOptions.Get().SkipInference)
+          Program.Announce("entrypoint::" + ep.Name + "::instrumented");
+      });
 
       Program.StopTimer();
 
@@ -156,17 +211,22 @@ namespace Whoop
 
       Program.StartTimer("SummaryGenerationEngine");
 
-      foreach (var ep in DeviceDriver.EntryPoints)
-      {
+      Program.ForEach(DeviceDriver.EntryPoints, ep => {
         var ac = AnalysisContext.GetAnalysisContext(ep);
         new WatchdogAnalysisEngine(ac, ep).Run();
-      }
+      });
+
+      Program.ForEach(DeviceDriver.EntryPoints, ep => {
+        if (WhoopEngineCommandLineOptions.Get().Incremental &&
+            !IncrementalInformation.IsPending(ep))
+          return;
+        if (DeviceDriver.GetPairs(ep).Count == 0)
+          return;
 
-      foreach (var ep in DeviceDriver.EntryPoints)
-      {
         var ac = AnalysisContext.GetAnalysisContext(ep);
         new SummaryGenerationEngine(ac, ep).Run();
-      }
+        Program.Announce("entrypoint::" + ep.Name + "::summarised");
+      });
 
       Program.StopTimer();
       SummaryInformationParser.ToFile(Program.FileList);
@@ -180,14 +240,100 @@ namespace Whoop
       new AnalysisContextParser(Program.FileList[Program.FileList.Count - 1],
         "wbpl").TryParseNew(ref analysisContext);
 
-      foreach (var pair in DeviceDriver.EntryPointPairs)
+      var pairs = DeviceDriver.EntryPointPairs.FindAll(val =>
+        !WhoopEngineCommandLineOptions.Get().Incremental ||
+        IncrementalInformation.IsPending(val));
+
+      // Each pair is instrumented on its own view of the parsed program, so the
+      // pairs do not see each other's declarations and can run concurrently.
+      Program.ForEach(pairs, pair => {
+        new PairWiseCheckingInstrumentationEngine(analysisContext.CreateView(), pair).Run();
+        Program.Announce("pair::" + pair.EntryPoint1.Name + "::" + pair.EntryPoint2.Name);
+      });
+
+      Program.StopTimer();
+    }
+
+    /// <summary>
+    /// Prunes the pairs whose entry points have disjoint footprints, or only share
+    /// memory regions that neither of them writes. These pairs are race free, so
+    /// they are dropped before any instrumentation, summarisation or checking. The
+    /// pruned pairs are printed for the race checker, which accounts for them as
+    /// verified.
+    /// </summary>
+    private static void PruneEntryPointPairs()
+    {
+      foreach (var pair in new List<EntryPointPair>(DeviceDriver.EntryPointPairs))
       {
-        new PairWiseCheckingInstrumentationEngine(analysisContext, pair).Run();
-        analysisContext.ResetAnalysisContext();
-        analysisContext.ResetToProgramTopLevelDeclarations();
+        if (Analysis.SharedStateAnalyser.HaveConflictingFootprints(pair))
+          continue;
+
+        DeviceDriver.PruneEntryPointPair(pair);
+        Program.Announce("pruned::" + pair.EntryPoint1.Name + "::" + pair.EntryPoint2.Name);
       }
 
-      Program.StopTimer();
+      DeviceDriver.EmitPrunedEntryPointPairs(Program.FileList);
+    }
+
+    /// <summary>
+    /// Runs the given action on each of the given entry points or pairs, using up
+    /// to /parallelEntryPoints tasks. The console output of each item is captured
+    /// and replayed in the order of the items, so the output does not depend on
+    /// the degree of parallelism.
+    /// </summary>
+    /// <param name="items">Entry points or pairs</param>
+    /// <param name="action">Action to run on each item</param>
+    private static void ForEach<T>(List<T> items, Action<T> action)
+    {
+      if (WhoopEngineCommandLineOptions.Get().ParallelEntryPoints <= 1)
+      {
+        foreach (var item in items)
+        {
+          ToolState.Cancellation.ThrowIfCancellationRequested();
+          action(item);
+        }
+        return;
+      }
+
+      var outputs = new Tuple<string, string>[items.Count];
+      var options = new ParallelOptions {
+        MaxDegreeOfParallelism = WhoopEngineCommandLineOptions.Get().ParallelEntryPoints,
+        CancellationToken = ToolState.Cancellation
+      };
+
+      Whoop.IO.ConsoleCapture.Install();
+      try
+      {
+        Parallel.For(0, items.Count, options, idx => {
+          Whoop.IO.ConsoleCapture.Begin();
+          try
+          {
+            action(items[idx]);
+          }
+          finally
+          {
+            outputs[idx] = Whoop.IO.ConsoleCapture.End();
+          }
+        });
+      }
+      finally
+      {
+        foreach (var output in outputs)
+        {
+          if (output != null)
+            Whoop.IO.ConsoleCapture.Replay(output);
+        }
+      }
+    }
+
+    /// <summary>
+    /// Tells the tools further down the pipeline that the given artifact is ready.
+    /// </summary>
+    /// <param name="artifact">Artifact</param>
+    private static void Announce(string artifact)
+    {
+      if (Program.Channel != null)
+        Program.Channel.Announce(artifact);
     }
 
     private static void StartTimer(string engineName)
@@ -0,0 +1,236 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.Linq;
+
+using Microsoft.Boogie;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Slices an inlined checking program down to the cone of influence of its
+  /// assertions, before the verification condition is generated.
+  ///
+  /// Blocks from which no assertion can be reached are cut off, as nothing that
+  /// happens after the last assertion of a path can make it fail. All assumptions
+  /// of the remaining blocks are kept, as they decide which paths reach the race
+  /// checking assertions. The variables that the assertions, the assumptions and
+  /// the calls read are relevant, and so are the variables that the assignments
+  /// to relevant variables read. Assignments and havocs of variables that are not
+  /// relevant are then removed, as no remaining command reads them.
+  /// </summary>
+  internal sealed class ConeOfInfluenceSlicer
+  {
+    #region fields
+
+    private Implementation Implementation;
+    private HashSet<string> RelevantVariables;
+
+    #endregion
+
+    #region public API
+
+    public ConeOfInfluenceSlicer(Implementation impl)
+    {
+      Contract.Requires(impl != null);
+      this.Implementation = impl;
+      this.RelevantVariables = new HashSet<string>();
+    }
+
+    /// <summary>
+    /// Slices the implementation.
+    /// </summary>
+    public void Run()
+    {
+      if (this.Implementation.Blocks.Count == 0)
+        return;
+
+      this.PruneBlocks();
+      this.ComputeRelevantVariables();
+      this.RemoveIrrelevantCommands();
+    }
+
+    #endregion
+
+    #region slicing methods
+
+    /// <summary>
+    /// Cuts off the blocks from which no assertion can be reached, and removes the
+    /// blocks that are no longer reachable from the entry block.
+    /// </summary>
+    private void PruneBlocks()
+    {
+      bool checksEnsures = this.Implementation.Proc.Ensures.Any(val => !val.Free);
+      var asserting = new HashSet<Block>(this.Implementation.Blocks.Where(val =>
+        val.Cmds.Any(cmd => this.IsAssertion(cmd)) ||
+        (checksEnsures && val.TransferCmd is ReturnCmd)));
+
+      bool changed = true;
+      while (changed)
+      {
+        changed = false;
+        foreach (var block in this.Implementation.Blocks)
+        {
+          if (asserting.Contains(block))
+            continue;
+          if (!(block.TransferCmd is GotoCmd) || !(block.TransferCmd as GotoCmd).
+            labelTargets.Any(val => asserting.Contains(val)))
+            continue;
+
+          asserting.Add(block);
+          changed = true;
+        }
+      }
+
+      foreach (var block in this.Implementation.Blocks)
+      {
+        if (asserting.Contains(block))
+          continue;
+        block.Cmds.Clear();
+        block.TransferCmd = new ReturnCmd(block.TransferCmd.tok);
+      }
+
+      var reachable = new HashSet<Block>();
+      var worklist = new Stack<Block>();
+      worklist.Push(this.Implementation.Blocks[0]);
+
+      while (worklist.Count > 0)
+      {
+        var block = worklist.Pop();
+        if (!reachable.Add(block))
+          continue;
+        if (block.TransferCmd is GotoCmd)
+        {
+          foreach (var target in (block.TransferCmd as GotoCmd).labelTargets)
+            worklist.Push(target);
+        }
+      }
+
+      this.Implementation.Blocks.RemoveAll(val => !reachable.Contains(val));
+    }
+
+    /// <summary>
+    /// Computes the variables that the assertions and assumptions depend on. The
+    /// variables are identified by name, so that a variable that has not been
+    /// resolved is never dropped from the cone.
+    /// </summary>
+    private void ComputeRelevantVariables()
+    {
+      foreach (var ensures in this.Implementation.Proc.Ensures.Where(val => !val.Free))
+        this.AddReadVariables(ensures.Condition);
+
+      var assigns = new List<AssignCmd>();
+      foreach (var cmd in this.Implementation.Blocks.SelectMany(val => val.Cmds))
+      {
+        if (cmd is AssignCmd)
+        {
+          assigns.Add(cmd as AssignCmd);
+          continue;
+        }
+        if (cmd is HavocCmd)
+          continue;
+
+        this.AddReadVariables(cmd);
+
+        if (cmd is CallCmd && (cmd as CallCmd).Proc != null)
+        {
+          foreach (var requires in (cmd as CallCmd).Proc.Requires)
+            this.AddReadVariables(requires.Condition);
+          foreach (var ensures in (cmd as CallCmd).Proc.Ensures)
+            this.AddReadVariables(ensures.Condition);
+        }
+      }
+
+      bool changed = true;
+      while (changed)
+      {
+        changed = false;
+        foreach (var assign in assigns.ToList())
+        {
+          if (!this.IsRelevant(assign))
+            continue;
+
+          foreach (var lhs in assign.Lhss)
+            this.AddReadVariables(lhs.AsExpr);
+          foreach (var rhs in assign.Rhss)
+            this.AddReadVariables(rhs);
+
+          assigns.Remove(assign);
+          changed = true;
+        }
+      }
+    }
+
+    private void RemoveIrrelevantCommands()
+    {
+      foreach (var block in this.Implementation.Blocks)
+      {
+        block.Cmds.RemoveAll(val =>
+          (val is AssignCmd && !this.IsRelevant(val as AssignCmd)) ||
+          (val is HavocCmd && !(val as HavocCmd).Vars.Any(v =>
+            this.RelevantVariables.Contains(v.Name))));
+      }
+    }
+
+    #endregion
+
+    #region helper functions
+
+    private bool IsAssertion(Cmd cmd)
+    {
+      if (cmd is AssertCmd)
+      {
+        var expr = (cmd as AssertCmd).Expr as LiteralExpr;
+        return expr == null || !expr.IsTrue;
+      }
+
+      if (cmd is CallCmd)
+      {
+        var proc = (cmd as CallCmd).Proc;
+        return proc == null || proc.Requires.Any(val => !val.Free);
+      }
+
+      return false;
+    }
+
+    private bool IsRelevant(AssignCmd assign)
+    {
+      return assign.Lhss.Any(val => this.RelevantVariables.Contains(
+        val.DeepAssignedIdentifier.Name));
+    }
+
+    private void AddReadVariables(Absy node)
+    {
+      var collector = new ReadCollector();
+      collector.Visit(node);
+      this.RelevantVariables.UnionWith(collector.Names);
+    }
+
+    /// <summary>
+    /// Collects the names of the variables that a command or expression refers to.
+    /// </summary>
+    private sealed class ReadCollector : StandardVisitor
+    {
+      public HashSet<string> Names = new HashSet<string>();
+
+      public override Expr VisitIdentifierExpr(IdentifierExpr node)
+      {
+        this.Names.Add(node.Name);
+        return base.VisitIdentifierExpr(node);
+      }
+    }
+
+    #endregion
+  }
+}
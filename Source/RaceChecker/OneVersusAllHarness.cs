@@ -0,0 +1,277 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.Linq;
+
+using Microsoft.Boogie;
+using Whoop.Domain.Drivers;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Checks an entry point against all of its partners with a single verification
+  /// condition. The harness picks one of the partners nondeterministically and runs
+  /// the checking program of that pair, so the pairs of a group are verified in one
+  /// prover session instead of one each.
+  ///
+  /// The race checking assertions of each pair are tagged with the checker of the
+  /// pair, so that a counterexample names the concrete partner that it races with.
+  /// With a verdict cache, the verdict of each pair is kept under a key that is
+  /// derived from the harness, and the harness is only verified if the verdict of
+  /// some pair is missing.
+  /// </summary>
+  internal sealed class OneVersusAllHarness
+  {
+    #region fields
+
+    private AnalysisContext AC;
+    private Implementation Harness;
+    private string Key;
+
+    private Dictionary<string, EntryPointPair> Pairs;
+    private Dictionary<EntryPointPair, Tuple<VC.VCGen.Outcome, List<Counterexample>>> Outcomes;
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// Creates the harness of the given group in the given merged program. The
+    /// checkers of the pairs are replaced by the harness.
+    /// </summary>
+    /// <param name="ac">Analysis context of the merged checking programs</param>
+    /// <param name="group">Entry point pairs that share an entry point</param>
+    public OneVersusAllHarness(AnalysisContext ac, List<EntryPointPair> group)
+    {
+      Contract.Requires(ac != null && group != null && group.Count > 0);
+      this.AC = ac;
+      this.Pairs = new Dictionary<string, EntryPointPair>();
+      this.Outcomes = new Dictionary<EntryPointPair, Tuple<VC.VCGen.Outcome, List<Counterexample>>>();
+
+      var ep = group.All(val => val.EntryPoint1.Equals(group[0].EntryPoint1) ||
+        val.EntryPoint2.Equals(group[0].EntryPoint1)) ? group[0].EntryPoint1 : group[0].EntryPoint2;
+
+      this.CreateHarness("harness$" + ep.Name, group);
+    }
+
+    /// <summary>
+    /// Verifies the harness, and attributes its counterexamples to the pairs.
+    /// </summary>
+    /// <param name="vcgen">Verification condition generator</param>
+    public void Verify(VC.ConditionGeneration vcgen)
+    {
+      Contract.Requires(vcgen != null);
+
+      if (VerdictCache.IsEnabled)
+      {
+        this.Key = VerdictCache.ComputeKey(this.AC, this.Harness);
+        if (this.Pairs.Keys.All(val => VerdictCache.Contains(VerdictCache.ComputeKey(this.Key, val))))
+          return;
+      }
+
+      if (WhoopRaceCheckerCommandLineOptions.Get().Trace)
+      {
+        Console.WriteLine("");
+        Console.WriteLine("Verifying {0} against {1} partner{2} ...", this.Harness.Name.Substring(7),
+          this.Pairs.Count, this.Pairs.Count == 1 ? "" : "s");
+      }
+
+      List<Counterexample> errors;
+      var vcOutcome = StaticLocksetAnalyser.VerifyChecker(vcgen, this.Harness, out errors);
+
+      if (vcOutcome == VC.VCGen.Outcome.Correct || vcOutcome == VC.VCGen.Outcome.ReachedBound)
+      {
+        foreach (var pair in this.Pairs.Values)
+          this.Outcomes.Add(pair, new Tuple<VC.VCGen.Outcome, List<Counterexample>>(vcOutcome, null));
+        return;
+      }
+
+      if (vcOutcome != VC.VCGen.Outcome.Errors || errors == null)
+        return;
+
+      bool isComplete = errors.Count < CommandLineOptions.Clo.ProverCCLimit;
+      foreach (var error in errors)
+      {
+        EntryPointPair pair = null;
+        string checker = null;
+        if (error is AssertCounterexample)
+          checker = QKeyValue.FindStringAttribute((error as AssertCounterexample).FailingAssert.Attributes, "pair");
+        if (checker == null || !this.Pairs.TryGetValue(checker, out pair))
+        {
+          isComplete = false;
+          continue;
+        }
+
+        if (!this.Outcomes.ContainsKey(pair))
+          this.Outcomes.Add(pair, new Tuple<VC.VCGen.Outcome, List<Counterexample>>(
+            VC.VCGen.Outcome.Errors, new List<Counterexample>()));
+        this.Outcomes[pair].Item2.Add(error);
+      }
+
+      // The prover stops after the error limit, so the pairs without a race are only
+      // known to be race free if the prover has found all races
+      if (!isComplete)
+        return;
+
+      foreach (var pair in this.Pairs.Values.Where(val => !this.Outcomes.ContainsKey(val)))
+        this.Outcomes.Add(pair, new Tuple<VC.VCGen.Outcome, List<Counterexample>>(
+          VC.VCGen.Outcome.Correct, null));
+    }
+
+    /// <summary>
+    /// Returns the outcome of the given pair, if the harness has decided it, together
+    /// with the cache key of its verdict. A pair whose verdict is cached counts as
+    /// decided, with an inconclusive outcome, as its verdict is replayed from the
+    /// cache. Pairs that the harness has not decided must be verified on their own.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="pair">Entry point pair</param>
+    /// <param name="outcome">Outcome</param>
+    /// <param name="errors">Counterexamples of the pair</param>
+    /// <param name="key">Cache key of the verdict of the pair, or null</param>
+    public bool TryGetOutcome(EntryPointPair pair, out VC.VCGen.Outcome outcome, out List<Counterexample> errors,
+      out string key)
+    {
+      Tuple<VC.VCGen.Outcome, List<Counterexample>> result = null;
+      outcome = VC.VCGen.Outcome.Inconclusive;
+      errors = null;
+      key = null;
+
+      if (this.Key != null)
+        key = VerdictCache.ComputeKey(this.Key, this.Pairs.First(val => val.Value.Equals(pair)).Key);
+
+      if (!this.Outcomes.TryGetValue(pair, out result))
+        return key != null && VerdictCache.Contains(key);
+
+      outcome = result.Item1;
+      errors = result.Item2;
+      return true;
+    }
+
+    #endregion
+
+    #region construction methods
+
+    private void CreateHarness(string name, List<EntryPointPair> group)
+    {
+      var locals = new List<Variable>();
+      var modifies = new List<IdentifierExpr>();
+      var blocks = new List<Block>();
+      var branches = new List<Block>();
+      var checkers = new List<Implementation>();
+
+      foreach (var pair in group)
+      {
+        var checker = this.AC.GetImplementation("check$" + pair.EntryPoint1.Name + "$" + pair.EntryPoint2.Name);
+        this.Pairs.Add(checker.Name, pair);
+        checkers.Add(checker);
+
+        var branch = this.CreateBranch(checker, "$pair" + branches.Count + "$", locals);
+        branches.Add(branch[0]);
+        blocks.AddRange(branch);
+
+        foreach (var ie in checker.Proc.Modifies)
+        {
+          if (modifies.Any(val => val.Name.Equals(ie.Name)))
+            continue;
+          modifies.Add(new IdentifierExpr(ie.tok, ie.Decl));
+        }
+      }
+
+      blocks.Insert(0, new Block(Token.NoToken, "$harness", new List<Cmd>(),
+        new GotoCmd(Token.NoToken, branches)));
+
+      var proc = new Procedure(Token.NoToken, name, new List<TypeVariable>(),
+        new List<Variable>(), new List<Variable>(), new List<Requires>(),
+        modifies, new List<Ensures>());
+
+      this.Harness = new Implementation(Token.NoToken, name, new List<TypeVariable>(),
+        new List<Variable>(), new List<Variable>(), locals, blocks);
+      this.Harness.Proc = proc;
+
+      // The checkers are part of the harness now, so they are not inlined twice
+      this.AC.TopLevelDeclarations.RemoveAll(val => checkers.Contains(val));
+      this.AC.Program.RemoveTopLevelDeclarations(val => checkers.Contains(val));
+
+      this.AC.TopLevelDeclarations.Add(proc);
+      this.AC.TopLevelDeclarations.Add(this.Harness);
+      this.AC.Program.AddTopLevelDeclaration(proc);
+      this.AC.Program.AddTopLevelDeclaration(this.Harness);
+    }
+
+    /// <summary>
+    /// Copies the blocks of the given checker into a branch of the harness. The
+    /// in-parameters of the checker become locals of the harness, which are left
+    /// unconstrained, and its preconditions are assumed at the start of the branch.
+    /// </summary>
+    /// <returns>Blocks of the branch, starting with its entry block</returns>
+    /// <param name="checker">Checker</param>
+    /// <param name="prefix">Prefix of the labels and locals of the branch</param>
+    /// <param name="locals">Locals of the harness</param>
+    private List<Block> CreateBranch(Implementation checker, string prefix, List<Variable> locals)
+    {
+      var map = new Dictionary<Variable, Expr>();
+      for (int i = 0; i < checker.InParams.Count; i++)
+      {
+        var local = this.CreateLocal(checker.InParams[i], prefix, locals);
+        map.Add(checker.InParams[i], local);
+        map.Add(checker.Proc.InParams[i], local);
+      }
+
+      foreach (var v in checker.LocVars)
+        map.Add(v, this.CreateLocal(v, prefix, locals));
+
+      var subst = Substituter.SubstitutionFromHashtable(map, false, null);
+      var copies = new Dictionary<Block, Block>();
+
+      foreach (var block in checker.Blocks)
+      {
+        var cmds = block.Cmds.Select(val => Substituter.Apply(subst, val)).ToList();
+        foreach (var assert in cmds.OfType<AssertCmd>().Where(val =>
+          QKeyValue.FindBoolAttribute(val.Attributes, "race_checking")))
+        {
+          assert.Attributes = new QKeyValue(Token.NoToken, "pair",
+            new List<object>() { checker.Name }, assert.Attributes);
+        }
+
+        copies.Add(block, new Block(block.tok, prefix + block.Label, cmds, null));
+      }
+
+      foreach (var block in checker.Blocks)
+      {
+        if (block.TransferCmd is GotoCmd)
+          copies[block].TransferCmd = new GotoCmd(block.TransferCmd.tok,
+            (block.TransferCmd as GotoCmd).labelTargets.Select(val => copies[val]).ToList());
+        else
+          copies[block].TransferCmd = new ReturnCmd(block.TransferCmd.tok);
+      }
+
+      var entry = copies[checker.Blocks[0]];
+      entry.Cmds.InsertRange(0, checker.Proc.Requires.Select(val =>
+        new AssumeCmd(val.tok, Substituter.Apply(subst, val.Condition))));
+
+      return checker.Blocks.Select(val => copies[val]).ToList();
+    }
+
+    private IdentifierExpr CreateLocal(Variable v, string prefix, List<Variable> locals)
+    {
+      var local = new LocalVariable(Token.NoToken, new TypedIdent(Token.NoToken,
+        prefix + v.Name, v.TypedIdent.Type));
+      locals.Add(local);
+      return new IdentifierExpr(local.tok, local);
+    }
+
+    #endregion
+  }
+}
@@ -12,8 +12,12 @@
 using System;
 using System.Diagnostics;
 using System.IO;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics.Contracts;
+using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
 
 using Microsoft.Boogie;
 using Whoop.Domain.Drivers;
@@ -22,7 +26,21 @@ namespace Whoop
 {
   public class Program
   {
+    private static object ParserLock = new object();
+
     public static void Main(string[] args)
+    {
+      Contract.Requires(cce.NonNullElements(args));
+      Environment.Exit(Program.Run(args));
+    }
+
+    /// <summary>
+    /// Runs the tool with the given arguments. This is kept separate from Main,
+    /// so that the Whoop daemon can run the tool inside its own process.
+    /// </summary>
+    /// <returns>Exit code</returns>
+    /// <param name="args">Arguments</param>
+    public static int Run(string[] args)
     {
       Contract.Requires(cce.NonNullElements(args));
 
@@ -34,13 +52,23 @@ namespace Whoop
 
         if (!WhoopRaceCheckerCommandLineOptions.Get().Parse(args))
         {
-          Environment.Exit((int)Outcome.FatalError);
+          return (int)Outcome.FatalError;
         }
 
+        WhoopRaceCheckerCommandLineOptions.Get().Arguments = args;
+
         if (WhoopRaceCheckerCommandLineOptions.Get().Files.Count == 0)
         {
           Whoop.IO.Reporter.ErrorWriteLine("Whoop: error: no input files were specified");
-          Environment.Exit((int)Outcome.FatalError);
+          return (int)Outcome.FatalError;
+        }
+
+        // Split pairs are verified one by one, so they are never merged into a harness
+        if (WhoopRaceCheckerCommandLineOptions.Get().OneVersusAll &&
+            WhoopRaceCheckerCommandLineOptions.Get().SplitResources > 0)
+        {
+          Whoop.IO.Reporter.AdvisoryWriteLine("Whoop: warning: /oneVersusAll has no effect " +
+            "together with /splitResources");
         }
 
         List<string> fileList = new List<string>();
@@ -66,12 +94,23 @@ namespace Whoop
           if (extension != ".bpl")
           {
             Whoop.IO.Reporter.ErrorWriteLine("Whoop: error: {0} is not a .bpl file", file);
-            Environment.Exit((int)Outcome.FatalError);
+            return (int)Outcome.FatalError;
           }
         }
 
         DeviceDriver.ParseAndInitialize(fileList);
-        Summarisation.SummaryInformationParser.FromFile(fileList);
+        if (VerdictCache.IsEnabled)
+          Whoop.IO.ConsoleCapture.Install();
+        if (WhoopRaceCheckerCommandLineOptions.Get().Pipeline)
+        {
+          Summarisation.SummaryInformationParser.AvailableSummaries = new List<string>();
+        }
+        else
+        {
+          Summarisation.SummaryInformationParser.FromFile(fileList);
+          if (WhoopRaceCheckerCommandLineOptions.Get().Incremental)
+            IncrementalInformation.ParseAndInitialize(fileList);
+        }
 
         PipelineStatistics stats = new PipelineStatistics();
         ExecutionTimer timer = null;
@@ -84,50 +123,87 @@ namespace Whoop
           timer.Start();
         }
 
-        var pairMap = new Dictionary<EntryPointPair, Tuple<AnalysisContext, ErrorReporter>>();
-        foreach (var pair in DeviceDriver.EntryPointPairs)
+        IEnumerable<EntryPointPair> pairs = DeviceDriver.EntryPointPairs;
+        if (WhoopRaceCheckerCommandLineOptions.Get().Pipeline)
         {
-          AnalysisContext ac = null;
-          var parser = new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl");
-          var errorReporter = new ErrorReporter(pair);
+          pairs = Program.ReceivePairs(fileList, stats);
+        }
+        else
+        {
+          // The pairs that the engine has pruned are race free, and have no
+          // checking program
+          DeviceDriver.ParsePrunedEntryPointPairs(fileList);
+          stats.VerifiedCount += DeviceDriver.PrunedEntryPointPairs.Count;
 
-          if (pair.EntryPoint1.Name.Equals(pair.EntryPoint2.Name))
+          if (WhoopRaceCheckerCommandLineOptions.Get().Incremental)
           {
-            string extension = null;
-            if (Summarisation.SummaryInformationParser.AvailableSummaries.Contains(pair.EntryPoint1.Name))
-              extension = "$summarised";
-            else
-              extension = "$instrumented";
-
-            parser.TryParseNew(ref ac, new List<string> { "check_" + pair.EntryPoint1.Name + "_" +
-              pair.EntryPoint2.Name, pair.EntryPoint1.Name + extension });
+            Program.ReuseOutcomes(stats);
+            pairs = DeviceDriver.EntryPointPairs.FindAll(val => IncrementalInformation.IsPending(val));
           }
-          else
-          {
-            string extension1 = null;
-            if (Summarisation.SummaryInformationParser.AvailableSummaries.Contains(pair.EntryPoint1.Name))
-              extension1 = "$summarised";
-            else
-              extension1 = "$instrumented";
+        }
 
-            string extension2 = null;
-            if (Summarisation.SummaryInformationParser.AvailableSummaries.Contains(pair.EntryPoint2.Name))
-              extension2 = "$summarised";
-            else
-              extension2 = "$instrumented";
+        // The pairs may still be arriving in pipeline mode, so they cannot be grouped
+        IEnumerable<List<EntryPointPair>> groups = pairs.Select(val => new List<EntryPointPair> { val });
+        if ((WhoopRaceCheckerCommandLineOptions.Get().GroupPairs ||
+            WhoopRaceCheckerCommandLineOptions.Get().OneVersusAll) &&
+            !WhoopRaceCheckerCommandLineOptions.Get().Pipeline)
+          groups = Program.GroupPairs(pairs.ToList());
+
+        var results = new ConcurrentDictionary<EntryPointPair,
+          Tuple<AnalysisContext, ErrorReporter, PipelineStatistics>>();
 
-            parser.TryParseNew(ref ac, new List<string> { "check_" + pair.EntryPoint1.Name + "_" +
-              pair.EntryPoint2.Name, pair.EntryPoint1.Name + extension1, pair.EntryPoint2.Name + extension2 });
+        if (WhoopRaceCheckerCommandLineOptions.Get().ParallelPairs > 1 ||
+            WhoopRaceCheckerCommandLineOptions.Get().Incremental ||
+            WhoopRaceCheckerCommandLineOptions.Get().Pipeline)
+        {
+          var outputs = new ConcurrentDictionary<EntryPointPair, Tuple<string, string>>();
+          var options = new ParallelOptions {
+            MaxDegreeOfParallelism = WhoopRaceCheckerCommandLineOptions.Get().ParallelPairs,
+            CancellationToken = ToolState.Cancellation
+          };
+
+          // The pairs may still be arriving from the engine and the cruncher, so
+          // they are handed out one at a time instead of in chunks
+          Whoop.IO.ConsoleCapture.Install();
+          Parallel.ForEach(Partitioner.Create(groups, EnumerablePartitionerOptions.NoBuffering),
+            options, group => {
+            Program.AnalyseGroup(group, fileList, results, outputs);
+          });
+
+          foreach (var pair in DeviceDriver.EntryPointPairs)
+          {
+            if (outputs.ContainsKey(pair))
+              Whoop.IO.ConsoleCapture.Replay(outputs[pair]);
           }
 
-          new StaticLocksetAnalyser(ac, pair, errorReporter, stats).Run();
-          pairMap.Add(pair, new Tuple<AnalysisContext, ErrorReporter>(ac, errorReporter));
+          if (WhoopRaceCheckerCommandLineOptions.Get().Incremental)
+          {
+            Program.RegisterOutcomes(results, outputs);
+            IncrementalInformation.ToFile(fileList);
+          }
+        }
+        else
+        {
+          foreach (var group in groups)
+            Program.AnalyseGroup(group, fileList, results, null);
+        }
+
+        var pairMap = new Dictionary<EntryPointPair, Tuple<AnalysisContext, ErrorReporter>>();
+        foreach (var pair in DeviceDriver.EntryPointPairs)
+        {
+          Tuple<AnalysisContext, ErrorReporter, PipelineStatistics> result = null;
+          if (!results.TryGetValue(pair, out result))
+            continue;
+
+          pairMap.Add(pair, new Tuple<AnalysisContext, ErrorReporter>(result.Item1, result.Item2));
+          Program.MergeStatistics(stats, result.Item3);
         }
 
         if (WhoopRaceCheckerCommandLineOptions.Get().FindBugs)
         {
           foreach (var pair in pairMap)
           {
+            ToolState.Cancellation.ThrowIfCancellationRequested();
             if (!WhoopRaceCheckerCommandLineOptions.Get().YieldAll &&
                 WhoopRaceCheckerCommandLineOptions.Get().SkipRaceFreePairs &&
                 !pair.Value.Item2.FoundErrors)
@@ -154,14 +230,350 @@ namespace Whoop
         if ((stats.ErrorCount + stats.InconclusiveCount + stats.TimeoutCount + stats.OutOfMemoryCount) > 0)
           oc = Outcome.LocksetAnalysisError;
 
-        Environment.Exit((int)oc);
+        return (int)oc;
       }
       catch (Exception e)
       {
+        var fatal = OutcomeException.Find(e);
+        if (fatal != null)
+        {
+          Whoop.IO.Reporter.ErrorWriteLine(fatal.Message);
+          return (int)fatal.Outcome;
+        }
+
         Console.Error.Write("Exception thrown in Whoop: ");
         Console.Error.WriteLine(e);
-        Environment.Exit((int)Outcome.FatalError);
+        return (int)Outcome.FatalError;
+      }
+      finally
+      {
+        ProverPool.Close();
+      }
+    }
+
+    /// <summary>
+    /// Analyses the given group of pairs. The pairs of a group share an entry point,
+    /// and are verified against one merged program in one prover session, so that
+    /// the program is sent to the prover once instead of once per pair. With
+    /// /oneVersusAll the pairs are verified together by a single harness, and only
+    /// the pairs that the harness cannot decide are verified one by one. The output
+    /// of each pair is captured into the given outputs, unless they are null.
+    /// </summary>
+    /// <param name="group">Entry point pairs</param>
+    /// <param name="fileList">File list</param>
+    /// <param name="results">Results</param>
+    /// <param name="outputs">Outputs</param>
+    private static void AnalyseGroup(List<EntryPointPair> group, List<string> fileList,
+      IDictionary<EntryPointPair, Tuple<AnalysisContext, ErrorReporter, PipelineStatistics>> results,
+      IDictionary<EntryPointPair, Tuple<string, string>> outputs)
+    {
+      AnalysisContext ac = null;
+      VC.ConditionGeneration vcgen = null;
+      OneVersusAllHarness harness = null;
+
+      // Pairs whose programs cannot be merged, or whose checks are split per
+      // resource, are verified one by one
+      bool isMerged = false;
+      if (group.Count > 1 && WhoopRaceCheckerCommandLineOptions.Get().SplitResources == 0)
+      {
+        lock (Program.ParserLock)
+        {
+          isMerged = new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl").
+            TryParseMerged(ref ac, group.ConvertAll(val => Program.GetPairFiles(val)));
+        }
+      }
+
+      // The provers of the merged program go back to the pool even if a pair fails
+      try
+      {
+        if (isMerged)
+        {
+          if (WhoopRaceCheckerCommandLineOptions.Get().OneVersusAll)
+            harness = new OneVersusAllHarness(ac, group);
+          vcgen = StaticLocksetAnalyser.Prepare(ac);
+          if (harness != null)
+            harness.Verify(vcgen);
+        }
+
+        foreach (var pair in group)
+        {
+          ToolState.Cancellation.ThrowIfCancellationRequested();
+          if (outputs != null)
+            Whoop.IO.ConsoleCapture.Begin();
+
+          try
+          {
+            VC.VCGen.Outcome outcome = VC.VCGen.Outcome.Correct;
+            List<Counterexample> errors = null;
+            string key = null;
+            if (vcgen == null || (harness != null && !harness.TryGetOutcome(pair, out outcome, out errors, out key)))
+            {
+              results[pair] = Program.AnalysePair(pair, fileList);
+              continue;
+            }
+
+            var errorReporter = new ErrorReporter(pair);
+            var stats = new PipelineStatistics();
+            if (harness != null)
+              new StaticLocksetAnalyser(ac, pair, errorReporter, stats).Run(outcome, errors, key);
+            else
+              new StaticLocksetAnalyser(ac, pair, errorReporter, stats).Run(vcgen);
+
+            // The merged program holds the entry points of the whole group, so yields
+            // are instrumented against the program of the pair alone
+            AnalysisContext pairAc = ac;
+            if (WhoopRaceCheckerCommandLineOptions.Get().FindBugs)
+            {
+              pairAc = null;
+              lock (Program.ParserLock)
+              {
+                new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl").
+                  TryParseNew(ref pairAc, Program.GetPairFiles(pair));
+              }
+            }
+
+            results[pair] = new Tuple<AnalysisContext, ErrorReporter, PipelineStatistics>(pairAc, errorReporter, stats);
+          }
+          finally
+          {
+            if (outputs != null)
+              outputs[pair] = Whoop.IO.ConsoleCapture.End();
+          }
+        }
+      }
+      finally
+      {
+        if (vcgen != null)
+          StaticLocksetAnalyser.Finish(ac, vcgen);
+      }
+    }
+
+    private static Tuple<AnalysisContext, ErrorReporter, PipelineStatistics> AnalysePair(
+      EntryPointPair pair, List<string> fileList)
+    {
+      AnalysisContext ac = null;
+      var parser = new AnalysisContextParser(fileList[fileList.Count - 1], "wbpl");
+      var errorReporter = new ErrorReporter(pair);
+      var stats = new PipelineStatistics();
+
+      var files = Program.GetPairFiles(pair);
+
+      if (WhoopRaceCheckerCommandLineOptions.Get().SplitResources > 0)
+      {
+        // Every resource is verified on its own copy of the parsed program. Parsing
+        // and type checking use shared Boogie state, so they are not run concurrently
+        lock (Program.ParserLock)
+        {
+          parser.TryDuplicateNew(ref ac, files);
+        }
+
+        new StaticLocksetAnalyser(ac, pair, errorReporter, stats).RunPerResource(() => {
+          AnalysisContext duplicate = null;
+          lock (Program.ParserLock)
+          {
+            parser.TryDuplicateNew(ref duplicate, files);
+          }
+          return duplicate;
+        });
+      }
+      else
+      {
+        lock (Program.ParserLock)
+        {
+          parser.TryParseNew(ref ac, files);
+        }
+
+        new StaticLocksetAnalyser(ac, pair, errorReporter, stats).Run();
+      }
+
+      return new Tuple<AnalysisContext, ErrorReporter, PipelineStatistics>(ac, errorReporter, stats);
+    }
+
+    /// <summary>
+    /// Returns the files that make up the checking program of the given pair.
+    /// </summary>
+    /// <returns>File names</returns>
+    /// <param name="pair">Entry point pair</param>
+    private static List<string> GetPairFiles(EntryPointPair pair)
+    {
+      if (pair.EntryPoint1.Name.Equals(pair.EntryPoint2.Name))
+      {
+        string extension = null;
+        if (Summarisation.SummaryInformationParser.AvailableSummaries.Contains(pair.EntryPoint1.Name))
+          extension = "$summarised";
+        else
+          extension = "$instrumented";
+
+        return new List<string> { "check_" + pair.EntryPoint1.Name + "_" +
+          pair.EntryPoint2.Name, pair.EntryPoint1.Name + extension };
+      }
+
+      string extension1 = null;
+      if (Summarisation.SummaryInformationParser.AvailableSummaries.Contains(pair.EntryPoint1.Name))
+        extension1 = "$summarised";
+      else
+        extension1 = "$instrumented";
+
+      string extension2 = null;
+      if (Summarisation.SummaryInformationParser.AvailableSummaries.Contains(pair.EntryPoint2.Name))
+        extension2 = "$summarised";
+      else
+        extension2 = "$instrumented";
+
+      return new List<string> { "check_" + pair.EntryPoint1.Name + "_" +
+        pair.EntryPoint2.Name, pair.EntryPoint1.Name + extension1, pair.EntryPoint2.Name + extension2 };
+    }
+
+    /// <summary>
+    /// Groups the given pairs by a shared entry point. The entry point that takes
+    /// part in most of the remaining pairs is picked first, so that the groups are
+    /// as large as possible.
+    /// </summary>
+    /// <returns>Groups of entry point pairs</returns>
+    /// <param name="pairs">Entry point pairs</param>
+    private static List<List<EntryPointPair>> GroupPairs(List<EntryPointPair> pairs)
+    {
+      var groups = new List<List<EntryPointPair>>();
+      var remaining = new List<EntryPointPair>(pairs);
+
+      while (remaining.Count > 0)
+      {
+        var ep = remaining.SelectMany(val => new List<EntryPoint> { val.EntryPoint1, val.EntryPoint2 }.Distinct()).
+          GroupBy(val => val).OrderByDescending(val => val.Count()).First().Key;
+        Predicate<EntryPointPair> sharesEntryPoint = val =>
+          val.EntryPoint1.Equals(ep) || val.EntryPoint2.Equals(ep);
+
+        groups.Add(remaining.FindAll(sharesEntryPoint));
+        remaining.RemoveAll(sharesEntryPoint);
+      }
+
+      return groups;
+    }
+
+    /// <summary>
+    /// Accounts for the pairs that are not pending, using the outcomes of the run
+    /// that last verified them, and replays their output.
+    /// </summary>
+    /// <param name="stats">Statistics</param>
+    private static void ReuseOutcomes(PipelineStatistics stats)
+    {
+      foreach (var pair in DeviceDriver.EntryPointPairs)
+      {
+        int verified, errors;
+        Tuple<string, string> output;
+        if (!IncrementalInformation.TryGetOutcome(pair, out verified, out errors, out output))
+          continue;
+
+        stats.VerifiedCount += verified;
+        stats.ErrorCount += errors;
+        Whoop.IO.ConsoleCapture.Replay(output);
       }
     }
+
+    /// <summary>
+    /// Stores the outcomes of the analysed pairs. Only conclusive outcomes are
+    /// stored, so pairs that were inconclusive or ran out of resources are
+    /// analysed again in the next run.
+    /// </summary>
+    private static void RegisterOutcomes(
+      IDictionary<EntryPointPair, Tuple<AnalysisContext, ErrorReporter, PipelineStatistics>> results,
+      IDictionary<EntryPointPair, Tuple<string, string>> outputs)
+    {
+      foreach (var result in results)
+      {
+        var pairStats = result.Value.Item3;
+        if ((pairStats.InconclusiveCount + pairStats.TimeoutCount + pairStats.OutOfMemoryCount) > 0)
+          continue;
+
+        IncrementalInformation.RegisterOutcome(result.Key, pairStats.VerifiedCount,
+          pairStats.ErrorCount, outputs[result.Key]);
+      }
+    }
+
+    /// <summary>
+    /// Returns the pairs as soon as they can be analysed, while the engine and the
+    /// cruncher are still running. A pair is ready once the engine has announced
+    /// its checking program, and the cruncher has announced the summaries of its
+    /// entry points.
+    /// </summary>
+    /// <returns>Entry point pairs</returns>
+    /// <param name="fileList">File list</param>
+    /// <param name="stats">Statistics</param>
+    private static IEnumerable<EntryPointPair> ReceivePairs(List<string> fileList, PipelineStatistics stats)
+    {
+      var engine = new Whoop.IO.PipelineChannel(fileList, "engine");
+      Whoop.IO.PipelineChannel cruncher = null;
+      if (!WhoopRaceCheckerCommandLineOptions.Get().SkipInference)
+        cruncher = new Whoop.IO.PipelineChannel(fileList, "cruncher");
+
+      var crunched = new HashSet<string>();
+      var received = new HashSet<EntryPointPair>();
+      var waiting = new List<EntryPointPair>();
+
+      while (!engine.IsClosed || waiting.Count > 0)
+      {
+        // The engine announces all entry points before the first pair, so the
+        // summaries are not modified while the pairs are analysed
+        foreach (var artifact in engine.Poll())
+        {
+          var tokens = artifact.Split(new string[] { "::" }, StringSplitOptions.None);
+          if (tokens[0].Equals("parsed") && WhoopRaceCheckerCommandLineOptions.Get().Incremental)
+          {
+            IncrementalInformation.ParseAndInitialize(fileList);
+            Program.ReuseOutcomes(stats);
+          }
+          else if (tokens[0].Equals("entrypoint") && tokens[2].Equals("summarised"))
+          {
+            Summarisation.SummaryInformationParser.RegisterSummaryName(tokens[1]);
+          }
+          else if (tokens[0].Equals("pruned"))
+          {
+            if (DeviceDriver.PruneEntryPointPair(DeviceDriver.GetEntryPointPair(tokens[1], tokens[2])))
+              stats.VerifiedCount++;
+          }
+          else if (tokens[0].Equals("pair"))
+          {
+            var pair = DeviceDriver.EntryPointPairs.Find(val => !received.Contains(val) &&
+              val.EntryPoint1.Name.Equals(tokens[1]) && val.EntryPoint2.Name.Equals(tokens[2]));
+            if (pair == null)
+              continue;
+
+            received.Add(pair);
+            waiting.Add(pair);
+          }
+        }
+
+        if (cruncher != null)
+        {
+          foreach (var artifact in cruncher.Poll())
+            crunched.Add(artifact.Split(new string[] { "::" }, StringSplitOptions.None)[1]);
+        }
+
+        var ready = waiting.FindAll(val => (cruncher != null && cruncher.IsClosed) ||
+          (Program.IsReady(val.EntryPoint1, crunched) && Program.IsReady(val.EntryPoint2, crunched)));
+        waiting.RemoveAll(val => ready.Contains(val));
+
+        foreach (var pair in ready)
+          yield return pair;
+
+        if (ready.Count == 0)
+          Thread.Sleep(Whoop.IO.PipelineChannel.PollingInterval);
+      }
+    }
+
+    private static bool IsReady(EntryPoint ep, HashSet<string> crunched)
+    {
+      return !Summarisation.SummaryInformationParser.AvailableSummaries.Contains(ep.Name) ||
+        crunched.Contains(ep.Name);
+    }
+
+    private static void MergeStatistics(PipelineStatistics stats, PipelineStatistics pairStats)
+    {
+      stats.VerifiedCount += pairStats.VerifiedCount;
+      stats.ErrorCount += pairStats.ErrorCount;
+      stats.InconclusiveCount += pairStats.InconclusiveCount;
+      stats.TimeoutCount += pairStats.TimeoutCount;
+      stats.OutOfMemoryCount += pairStats.OutOfMemoryCount;
+    }
   }
 }
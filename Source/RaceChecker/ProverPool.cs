@@ -0,0 +1,138 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.Linq;
+
+using Microsoft.Boogie;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Keeps the prover processes alive across entry point pairs, instead of spawning
+  /// a fresh prover for every pair. All pairs verify through the same list of Boogie
+  /// checkers; Boogie hands an idle checker to the next pair and retargets it to the
+  /// pair's program, which resets the prover. The pool starts the checkers itself,
+  /// up to its size, so that the verification cores of Boogie are left alone.
+  ///
+  /// Only z3 can be reset without restarting its process, so with any other solver
+  /// every pair still gets its own provers.
+  /// </summary>
+  internal static class ProverPool
+  {
+    #region fields
+
+    private static List<Checker> Checkers = new List<Checker>();
+
+    private static bool IsEnabled
+    {
+      get
+      {
+        return WhoopRaceCheckerCommandLineOptions.Get().ProverPoolSize > 0 &&
+          !WhoopRaceCheckerCommandLineOptions.Get().ProverOptions.Any(val =>
+            val.StartsWith("SOLVER=") && !val.Equals("SOLVER=z3"));
+      }
+    }
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// The number of provers that the pool keeps. It holds a prover for each pair,
+    /// or each resource of a split pair, that is checked concurrently.
+    /// </summary>
+    private static int Size
+    {
+      get
+      {
+        return Math.Max(WhoopRaceCheckerCommandLineOptions.Get().ProverPoolSize,
+          WhoopRaceCheckerCommandLineOptions.Get().ParallelPairs *
+          Math.Max(1, WhoopRaceCheckerCommandLineOptions.Get().SplitResources));
+      }
+    }
+
+    /// <summary>
+    /// Creates a verification condition generator for the given program, which
+    /// draws its provers from the pool.
+    /// </summary>
+    /// <returns>Verification condition generator</returns>
+    /// <param name="program">Program</param>
+    public static VC.ConditionGeneration CreateVCGen(Microsoft.Boogie.Program program)
+    {
+      Contract.Requires(program != null);
+      if (!ProverPool.IsEnabled)
+        return new VC.VCGen(program, WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFilePath,
+          WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFileAppend, new List<Checker>());
+
+      var vcgen = new VC.VCGen(program, WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFilePath,
+        WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFileAppend, ProverPool.Checkers);
+      ProverPool.Grow(vcgen, program);
+
+      return vcgen;
+    }
+
+    /// <summary>
+    /// Closes all provers of the pool.
+    /// </summary>
+    public static void Close()
+    {
+      lock (ProverPool.Checkers)
+      {
+        foreach (var checker in ProverPool.Checkers)
+        {
+          if (!checker.IsClosed)
+            checker.Close();
+        }
+
+        ProverPool.Checkers.Clear();
+      }
+
+      if (WhoopRaceCheckerCommandLineOptions.Get().TheProverFactory != null)
+        WhoopRaceCheckerCommandLineOptions.Get().TheProverFactory.Close();
+    }
+
+    #endregion
+
+    #region helper functions
+
+    /// <summary>
+    /// Starts a prover for the given program if all provers of the pool are in use
+    /// and the pool has not reached its size. Boogie only starts a prover itself
+    /// while it has fewer checkers than verification cores, and it hands any idle
+    /// checker in the list to the program that asks for one.
+    /// </summary>
+    /// <param name="vcgen">Verification condition generator</param>
+    /// <param name="program">Program</param>
+    private static void Grow(VC.ConditionGeneration vcgen, Microsoft.Boogie.Program program)
+    {
+      lock (ProverPool.Checkers)
+      {
+        if (ProverPool.Checkers.Count >= ProverPool.Size ||
+            ProverPool.Checkers.Any(val => val.IsIdle))
+          return;
+
+        // Boogie numbers the log files of the checkers it starts in the same way
+        string logFilePath = WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFilePath;
+        if (logFilePath != null && !logFilePath.Contains("@PROC@") && ProverPool.Checkers.Count > 0)
+          logFilePath = logFilePath + "." + ProverPool.Checkers.Count;
+
+        ProverPool.Checkers.Add(new Checker(vcgen, program, logFilePath,
+          WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFileAppend,
+          WhoopRaceCheckerCommandLineOptions.Get().ProverKillTime));
+      }
+    }
+
+    #endregion
+  }
+}
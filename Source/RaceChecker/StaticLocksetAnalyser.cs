@@ -14,6 +14,8 @@ using System.IO;
 using System.Collections.Generic;
 using System.Diagnostics.Contracts;
 using System.Linq;
+using System.Threading;
+using System.Threading.Tasks;
 
 using Microsoft.Boogie;
 using Whoop.Domain.Drivers;
@@ -45,53 +47,295 @@ namespace Whoop
 
     public void Run()
     {
-      if (WhoopRaceCheckerCommandLineOptions.Get().MeasurePassExecutionTime)
+      this.StartTimer();
+
+      var vcgen = StaticLocksetAnalyser.Prepare(this.AC);
+      try
       {
-        Console.WriteLine(" |------ [{0} :: {1}]", this.EP1.Name, this.EP2.Name);
-        Console.WriteLine(" |  |");
-        this.Timer = new ExecutionTimer();
-        this.Timer.Start();
+        this.Verify(vcgen);
       }
+      finally
+      {
+        StaticLocksetAnalyser.Finish(this.AC, vcgen);
+      }
+
+      this.StopTimer();
+    }
+
+    /// <summary>
+    /// Verifies the pair using the given verification condition generator, which
+    /// the pair shares with other pairs of the same analysis context.
+    /// </summary>
+    /// <param name="vcgen">Verification condition generator</param>
+    public void Run(VC.ConditionGeneration vcgen)
+    {
+      Contract.Requires(vcgen != null);
+      this.StartTimer();
+      this.Verify(vcgen);
+      this.StopTimer();
+    }
+
+    /// <summary>
+    /// Accounts for the pair using the outcome that a one-versus-all harness has
+    /// found for it, together with the counterexamples that name the pair. If the
+    /// verdict of the pair is in the verdict cache, it is replayed instead.
+    /// </summary>
+    /// <param name="outcome">Outcome of the pair</param>
+    /// <param name="errors">Counterexamples of the pair</param>
+    /// <param name="key">Cache key of the verdict of the pair, or null</param>
+    public void Run(VC.VCGen.Outcome outcome, List<Counterexample> errors, string key)
+    {
+      this.StartTimer();
+
+      DateTime start = this.TraceStart("$" + this.EP1.Name + "$" + this.EP2.Name);
 
-      this.AC.EliminateDeadVariables();
-      this.AC.Inline();
+      if (key != null)
+      {
+        if (VerdictCache.TryReplay(key, this.ErrorReporter, this.Stats))
+        {
+          this.StopTimer();
+          return;
+        }
+
+        Whoop.IO.ConsoleCapture.Begin();
+      }
+
+      int prevVerifiedCount = this.Stats.VerifiedCount;
+      int prevErrorCount = this.Stats.ErrorCount;
+
+      try
+      {
+        this.ProcessOutcome(null, outcome, errors, this.GetTimeIndication(start, 0), this.Stats);
+      }
+      finally
+      {
+        if (key != null)
+        {
+          var output = Whoop.IO.ConsoleCapture.End();
+          Whoop.IO.ConsoleCapture.Replay(output);
+          if (outcome == VC.VCGen.Outcome.Correct || outcome == VC.VCGen.Outcome.Errors ||
+              outcome == VC.VCGen.Outcome.ReachedBound)
+            VerdictCache.Store(key, this.ErrorReporter, this.Stats.VerifiedCount - prevVerifiedCount,
+              this.Stats.ErrorCount - prevErrorCount, output);
+        }
+      }
+
+      if (outcome == VC.VCGen.Outcome.Errors || WhoopRaceCheckerCommandLineOptions.Get().Trace)
+        Console.Out.Flush();
+
+      this.StopTimer();
+    }
+
+    /// <summary>
+    /// Prepares the program of the given analysis context for verification, and
+    /// creates a verification condition generator for it. The inlined checkers are
+    /// sliced to the cone of influence of their assertions if /slicing is given.
+    /// </summary>
+    /// <returns>Verification condition generator</returns>
+    /// <param name="ac">AnalysisContext</param>
+    public static VC.ConditionGeneration Prepare(AnalysisContext ac)
+    {
+      Contract.Requires(ac != null);
+      ac.EliminateDeadVariables();
+      ac.Inline();
       if (WhoopRaceCheckerCommandLineOptions.Get().LoopUnrollCount != -1)
-        this.AC.Program.UnrollLoops(WhoopRaceCheckerCommandLineOptions.Get().LoopUnrollCount,
+        ac.Program.UnrollLoops(WhoopRaceCheckerCommandLineOptions.Get().LoopUnrollCount,
           WhoopRaceCheckerCommandLineOptions.Get().SoundLoopUnrolling);
-
-      string checkerName = "check$" + this.EP1.Name + "$" + this.EP2.Name;
-      Implementation checker = this.AC.TopLevelDeclarations.OfType<Implementation>().ToList().
-        Find(val => val.Name.Equals(checkerName));
-      Contract.Assert(checker != null);
+      if (WhoopRaceCheckerCommandLineOptions.Get().SliceCheckers)
+      {
+        foreach (var impl in ac.Program.Implementations.ToList())
+          new ConeOfInfluenceSlicer(impl).Run();
+      }
 
       VC.ConditionGeneration vcgen = null;
 
       try
       {
-        vcgen = new VC.VCGen(this.AC.Program, WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFilePath,
-          WhoopRaceCheckerCommandLineOptions.Get().SimplifyLogFileAppend, new List<Checker>());
+        vcgen = ProverPool.CreateVCGen(ac.Program);
       }
       catch (ProverException e)
       {
-        Whoop.IO.Reporter.ErrorWriteLine("Fatal Error: ProverException: {0}", e);
-        Environment.Exit((int)Outcome.FatalError);
+        throw new OutcomeException(Outcome.FatalError, String.Format(
+          "Fatal Error: ProverException: {0}", e));
       }
 
+      return vcgen;
+    }
+
+    /// <summary>
+    /// Disposes the given verification condition generator, once all pairs of the
+    /// given analysis context have been verified. Its provers stay in the pool.
+    /// </summary>
+    /// <param name="ac">AnalysisContext</param>
+    /// <param name="vcgen">Verification condition generator</param>
+    public static void Finish(AnalysisContext ac, VC.ConditionGeneration vcgen)
+    {
+      Contract.Requires(ac != null && vcgen != null);
+      vcgen.Dispose();
+    }
+
+    /// <summary>
+    /// Verifies the pair one resource at a time. Each resource is checked on its own
+    /// copy of the checking program, which keeps only the race checking assertion of
+    /// that resource, so that the resources are discharged in parallel and a hard
+    /// resource does not hold up the others. Resources that have been proved race-free
+    /// before, in this run or in one that shares its incremental information or its
+    /// verdict cache, are skipped. Once a race is found the verdict of the pair is known, so
+    /// the resources that have not been started yet are skipped as well, unless all
+    /// races are needed to find bugs.
+    /// </summary>
+    /// <param name="duplicate">Creates a fresh copy of the analysis context of the pair</param>
+    public void RunPerResource(Func<AnalysisContext> duplicate)
+    {
+      Contract.Requires(duplicate != null);
+      var resources = StaticLocksetAnalyser.GetResources(this.GetChecker(this.AC));
+      if (resources.Count < 2)
+      {
+        this.Run();
+        return;
+      }
+
+      this.StartTimer();
+
+      Implementation checker = this.GetChecker(this.AC);
+      DateTime start = this.TraceStart(checker.Name.Substring(5));
+
+      var outcomes = new VC.VCGen.Outcome[resources.Count];
+      var errors = new List<Counterexample>[resources.Count];
+      int poCount = 0;
+      bool foundRace = false;
+
+      var options = new ParallelOptions {
+        MaxDegreeOfParallelism = WhoopRaceCheckerCommandLineOptions.Get().SplitResources,
+        CancellationToken = ToolState.Cancellation
+      };
+
+      Parallel.For(0, resources.Count, options, idx => {
+        outcomes[idx] = VC.VCGen.Outcome.Correct;
+        if (Volatile.Read(ref foundRace) && !WhoopRaceCheckerCommandLineOptions.Get().FindBugs)
+          return;
+
+        var ac = duplicate();
+        var resourceChecker = this.GetChecker(ac);
+        StaticLocksetAnalyser.RemoveOtherResources(resourceChecker, resources[idx]);
+
+        string fingerprint = null;
+        if (WhoopRaceCheckerCommandLineOptions.Get().Incremental)
+        {
+          fingerprint = IncrementalInformation.ComputeFingerprint(ac);
+          if (IncrementalInformation.IsRaceFree(fingerprint))
+            return;
+        }
+
+        string key = null;
+        if (VerdictCache.IsEnabled)
+        {
+          key = VerdictCache.ComputeKey(ac, resourceChecker);
+          if (VerdictCache.IsRaceFree(key))
+            return;
+        }
+
+        var vcgen = StaticLocksetAnalyser.Prepare(ac);
+        try
+        {
+          int prevAssertionCount = vcgen.CumulativeAssertionCount;
+          outcomes[idx] = StaticLocksetAnalyser.VerifyChecker(vcgen, resourceChecker, out errors[idx]);
+          Interlocked.Add(ref poCount, vcgen.CumulativeAssertionCount - prevAssertionCount);
+        }
+        finally
+        {
+          StaticLocksetAnalyser.Finish(ac, vcgen);
+        }
+
+        if (outcomes[idx] == VC.VCGen.Outcome.Correct)
+        {
+          if (fingerprint != null)
+            IncrementalInformation.RegisterRaceFree(fingerprint);
+          if (key != null)
+            VerdictCache.RegisterRaceFree(key);
+        }
+        else if (outcomes[idx] == VC.VCGen.Outcome.Errors && errors[idx] != null && errors[idx].Count > 0)
+          Volatile.Write(ref foundRace, true);
+      });
+
+      // Any race decides the pair, and otherwise the least conclusive outcome does
+      var vcOutcome = VC.VCGen.Outcome.Correct;
+      List<Counterexample> allErrors = null;
+      for (int idx = 0; idx < resources.Count; idx++)
+      {
+        if (outcomes[idx] == VC.VCGen.Outcome.Errors)
+        {
+          vcOutcome = VC.VCGen.Outcome.Errors;
+          allErrors = allErrors ?? new List<Counterexample>();
+          if (errors[idx] != null)
+            allErrors.AddRange(errors[idx]);
+        }
+        else if (vcOutcome != VC.VCGen.Outcome.Errors &&
+          StaticLocksetAnalyser.GetRank(outcomes[idx]) > StaticLocksetAnalyser.GetRank(vcOutcome))
+        {
+          vcOutcome = outcomes[idx];
+        }
+      }
+
+      this.ProcessOutcome(checker, vcOutcome, allErrors, this.GetTimeIndication(start, poCount), this.Stats);
+
+      if (vcOutcome == VC.VCGen.Outcome.Errors || WhoopRaceCheckerCommandLineOptions.Get().Trace)
+        Console.Out.Flush();
+
+      this.StopTimer();
+    }
+
+    private void Verify(VC.ConditionGeneration vcgen)
+    {
+      Implementation checker = this.GetChecker(this.AC);
+      DateTime start = this.TraceStart(checker.Name.Substring(5));
       int prevAssertionCount = vcgen.CumulativeAssertionCount;
 
-      List<Counterexample> errors;
+      string key = null;
+      if (VerdictCache.IsEnabled)
+      {
+        key = VerdictCache.ComputeKey(this.AC, checker);
+        if (VerdictCache.TryReplay(key, this.ErrorReporter, this.Stats))
+          return;
+        Whoop.IO.ConsoleCapture.Begin();
+      }
 
-      DateTime start = new DateTime();
-      if (WhoopRaceCheckerCommandLineOptions.Get().Trace)
+      int prevVerifiedCount = this.Stats.VerifiedCount;
+      int prevErrorCount = this.Stats.ErrorCount;
+
+      var vcOutcome = VC.VCGen.Outcome.Inconclusive;
+      Tuple<string, string> output = null;
+      try
       {
-        start = DateTime.UtcNow;
-        if (WhoopRaceCheckerCommandLineOptions.Get().Trace)
+        List<Counterexample> errors;
+        vcOutcome = StaticLocksetAnalyser.VerifyChecker(vcgen, checker, out errors);
+
+        this.ProcessOutcome(checker, vcOutcome, errors, this.GetTimeIndication(start,
+          vcgen.CumulativeAssertionCount - prevAssertionCount), this.Stats);
+      }
+      finally
+      {
+        // The capture is ended even if the prover fails, or it would swallow the
+        // output of everything that runs on this thread afterwards
+        if (key != null)
         {
-          Console.WriteLine("");
-          Console.WriteLine("Verifying {0} ...", checker.Name.Substring(5));
+          output = Whoop.IO.ConsoleCapture.End();
+          Whoop.IO.ConsoleCapture.Replay(output);
         }
       }
 
+      if (key != null && (vcOutcome == VC.VCGen.Outcome.Correct ||
+          vcOutcome == VC.VCGen.Outcome.Errors || vcOutcome == VC.VCGen.Outcome.ReachedBound))
+        VerdictCache.Store(key, this.ErrorReporter, this.Stats.VerifiedCount - prevVerifiedCount,
+          this.Stats.ErrorCount - prevErrorCount, output);
+
+      if (vcOutcome == VC.VCGen.Outcome.Errors || WhoopRaceCheckerCommandLineOptions.Get().Trace)
+        Console.Out.Flush();
+    }
+
+    internal static VC.VCGen.Outcome VerifyChecker(VC.ConditionGeneration vcgen, Implementation checker,
+      out List<Counterexample> errors)
+    {
       VC.VCGen.Outcome vcOutcome;
       try
       {
@@ -112,26 +356,104 @@ namespace Whoop
         vcOutcome = VC.VCGen.Outcome.Inconclusive;
       }
 
-      string timeIndication = "";
-      DateTime end = DateTime.UtcNow;
-      TimeSpan elapsed = end - start;
+      return vcOutcome;
+    }
+
+    private Implementation GetChecker(AnalysisContext ac)
+    {
+      string checkerName = "check$" + this.EP1.Name + "$" + this.EP2.Name;
+      Implementation checker = ac.TopLevelDeclarations.OfType<Implementation>().ToList().
+        Find(val => val.Name.Equals(checkerName));
+      Contract.Assert(checker != null);
+      return checker;
+    }
+
+    /// <summary>
+    /// Returns the resources that the given checker has race checking assertions for.
+    /// </summary>
+    /// <returns>Resource names</returns>
+    /// <param name="checker">Checker</param>
+    private static List<string> GetResources(Implementation checker)
+    {
+      var resources = new List<string>();
+      foreach (var assert in checker.Blocks.SelectMany(val => val.Cmds).OfType<AssertCmd>())
+      {
+        var resource = QKeyValue.FindStringAttribute(assert.Attributes, "resource");
+        if (resource != null && !resources.Contains(resource))
+          resources.Add(resource);
+      }
+
+      return resources;
+    }
+
+    private static void RemoveOtherResources(Implementation checker, string resource)
+    {
+      foreach (var block in checker.Blocks)
+      {
+        block.Cmds.RemoveAll(val => {
+          if (!(val is PredicateCmd))
+            return false;
+          var current = QKeyValue.FindStringAttribute((val as PredicateCmd).Attributes, "resource");
+          return current != null && !current.Equals(resource);
+        });
+      }
+    }
 
+    private static int GetRank(VC.VCGen.Outcome outcome)
+    {
+      switch (outcome)
+      {
+        case VC.VCGen.Outcome.Correct:
+          return 0;
+        case VC.VCGen.Outcome.ReachedBound:
+          return 1;
+        case VC.VCGen.Outcome.Inconclusive:
+          return 2;
+        case VC.VCGen.Outcome.OutOfMemory:
+          return 3;
+        case VC.VCGen.Outcome.TimedOut:
+          return 4;
+        default:
+          return 5;
+      }
+    }
+
+    private DateTime TraceStart(string name)
+    {
+      DateTime start = new DateTime();
       if (WhoopRaceCheckerCommandLineOptions.Get().Trace)
       {
-        int poCount = vcgen.CumulativeAssertionCount - prevAssertionCount;
-        timeIndication = string.Format("  [{0:F3} s, {1} proof obligation{2}]  ",
-          elapsed.TotalSeconds, poCount, poCount == 1 ? "" : "s");
+        start = DateTime.UtcNow;
+        Console.WriteLine("");
+        Console.WriteLine("Verifying {0} ...", name);
       }
 
-      this.ProcessOutcome(checker, vcOutcome, errors, timeIndication, this.Stats);
+      return start;
+    }
 
-      if (vcOutcome == VC.VCGen.Outcome.Errors || WhoopRaceCheckerCommandLineOptions.Get().Trace)
-        Console.Out.Flush();
+    private string GetTimeIndication(DateTime start, int poCount)
+    {
+      if (!WhoopRaceCheckerCommandLineOptions.Get().Trace)
+        return "";
 
-      WhoopRaceCheckerCommandLineOptions.Get().TheProverFactory.Close();
-//      cce.NonNull(WhoopRaceCheckerCommandLineOptions.Get().TheProverFactory).Close();
-      vcgen.Dispose();
+      TimeSpan elapsed = DateTime.UtcNow - start;
+      return string.Format("  [{0:F3} s, {1} proof obligation{2}]  ",
+        elapsed.TotalSeconds, poCount, poCount == 1 ? "" : "s");
+    }
 
+    private void StartTimer()
+    {
+      if (WhoopRaceCheckerCommandLineOptions.Get().MeasurePassExecutionTime)
+      {
+        Console.WriteLine(" |------ [{0} :: {1}]", this.EP1.Name, this.EP2.Name);
+        Console.WriteLine(" |  |");
+        this.Timer = new ExecutionTimer();
+        this.Timer.Start();
+      }
+    }
+
+    private void StopTimer()
+    {
       if (WhoopRaceCheckerCommandLineOptions.Get().MeasurePassExecutionTime)
       {
         this.Timer.Stop();
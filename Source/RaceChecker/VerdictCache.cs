@@ -0,0 +1,265 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Linq;
+using System.Security.Cryptography;
+using System.Text;
+
+using Microsoft.Boogie;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Keeps the verdicts of pair checks on disk, across runs, drivers and versions
+  /// of the same driver. A verdict is keyed by a hash of the inlined checking
+  /// program and of the options that can change the verdict, so any pair whose
+  /// checking program has been verified before is answered without the prover.
+  ///
+  /// Each verdict lives in its own file in the cache directory, so that several
+  /// runs can share the cache. Resources that a split pair check has proved
+  /// race-free are kept in the same way.
+  /// </summary>
+  internal static class VerdictCache
+  {
+    #region fields
+
+    /// <summary>
+    /// Options that only change how the pairs are scheduled, and not their verdicts.
+    /// </summary>
+    private static readonly string[] IgnoredOptions = new string[] {
+      "parallelPairs", "groupPairs", "oneVersusAll", "splitResources", "proverPoolSize",
+      "verdictCache", "incremental", "pipeline"
+    };
+
+    /// <summary>
+    /// Options that name files. Their paths differ across checkouts and versions of
+    /// a driver, while anything they contribute to a verdict is in the program.
+    /// </summary>
+    private static readonly string[] PathOptions = new string[] {
+      "originalFile", "whoopDecl", "kernelRules", "z3exe", "cvc4exe", "proverLog"
+    };
+
+    public static bool IsEnabled
+    {
+      get
+      {
+        return !WhoopRaceCheckerCommandLineOptions.Get().VerdictCache.Equals("");
+      }
+    }
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// Computes the cache key of the given checker. The declarations of the program
+    /// are hashed in a canonical order, so the key does not depend on the order of
+    /// the input files.
+    /// </summary>
+    /// <returns>Cache key</returns>
+    /// <param name="ac">Analysis context of the prepared checking program</param>
+    /// <param name="checker">Checker</param>
+    public static string ComputeKey(AnalysisContext ac, Implementation checker)
+    {
+      Contract.Requires(ac != null && checker != null);
+
+      var text = new StringBuilder();
+      text.AppendLine(checker.Name);
+      // The arguments of the run are used instead of those of the process, which
+      // belong to the daemon if there is one; input files given as absolute paths
+      // look like options, but they are hashed through the program
+      foreach (var arg in WhoopRaceCheckerCommandLineOptions.Get().Arguments.Where(val =>
+        val.StartsWith("/") && !File.Exists(val) && !VerdictCache.IgnoredOptions.
+        Concat(VerdictCache.PathOptions).Any(opt => val.Substring(1).Split(':')[0].Equals(opt))))
+        text.AppendLine(arg);
+
+      var decls = new List<string>();
+      foreach (var decl in ac.Program.TopLevelDeclarations)
+      {
+        using (var writer = new StringWriter())
+        {
+          decl.Emit(new TokenTextWriter(writer), 0);
+          decls.Add(writer.ToString());
+        }
+      }
+
+      decls.Sort(StringComparer.Ordinal);
+      foreach (var decl in decls)
+        text.Append(decl);
+
+      return VerdictCache.ComputeHash(text.ToString());
+    }
+
+    /// <summary>
+    /// Computes the cache key of the given checker of a harness, which is decided
+    /// by verifying the harness with the given cache key.
+    /// </summary>
+    /// <returns>Cache key</returns>
+    /// <param name="key">Cache key of the harness</param>
+    /// <param name="checker">Name of the checker</param>
+    public static string ComputeKey(string key, string checker)
+    {
+      Contract.Requires(key != null && checker != null);
+      return VerdictCache.ComputeHash(key + "\n" + checker);
+    }
+
+    /// <summary>
+    /// Checks if there is a verdict with the given key.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="key">Cache key</param>
+    public static bool Contains(string key)
+    {
+      Contract.Requires(key != null);
+      return File.Exists(VerdictCache.GetFileName(key, "verdict"));
+    }
+
+    /// <summary>
+    /// Looks up the verdict with the given key. On a hit, the verdict is accounted
+    /// for in the given error reporter and statistics, and its output is replayed.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="key">Cache key</param>
+    /// <param name="errorReporter">Error reporter</param>
+    /// <param name="stats">Statistics</param>
+    public static bool TryReplay(string key, ErrorReporter errorReporter, PipelineStatistics stats)
+    {
+      Contract.Requires(key != null && errorReporter != null && stats != null);
+
+      string[] info = null;
+      try
+      {
+        var file = VerdictCache.GetFileName(key, "verdict");
+        if (!File.Exists(file))
+          return false;
+        info = File.ReadAllText(file).Trim().Split(new string[] { "::" }, StringSplitOptions.None);
+      }
+      catch (IOException)
+      {
+        return false;
+      }
+
+      if (info.Length != 5)
+        return false;
+
+      stats.VerifiedCount += Int32.Parse(info[0]);
+      stats.ErrorCount += Int32.Parse(info[1]);
+      foreach (var resource in info[2].Split(new char[] { ',' }, StringSplitOptions.RemoveEmptyEntries))
+        errorReporter.UnprotectedResources.Add(VerdictCache.Decode(resource));
+      errorReporter.FoundErrors = Int32.Parse(info[1]) > 0;
+
+      Whoop.IO.ConsoleCapture.Replay(new Tuple<string, string>(
+        VerdictCache.Decode(info[3]), VerdictCache.Decode(info[4])));
+
+      return true;
+    }
+
+    /// <summary>
+    /// Stores a verdict under the given key. Only conclusive verdicts are stored.
+    /// </summary>
+    /// <param name="key">Cache key</param>
+    /// <param name="errorReporter">Error reporter of the verdict</param>
+    /// <param name="verified">Number of verified checks</param>
+    /// <param name="errors">Number of errors</param>
+    /// <param name="output">Captured standard output and error of the verdict</param>
+    public static void Store(string key, ErrorReporter errorReporter, int verified, int errors,
+      Tuple<string, string> output)
+    {
+      Contract.Requires(key != null && errorReporter != null && output != null);
+
+      var text = verified + "::" + errors + "::" +
+        string.Join(",", errorReporter.UnprotectedResources.Select(val => VerdictCache.Encode(val))) +
+        "::" + VerdictCache.Encode(output.Item1) + "::" + VerdictCache.Encode(output.Item2);
+
+      VerdictCache.Write(VerdictCache.GetFileName(key, "verdict"), text);
+    }
+
+    /// <summary>
+    /// Checks if the per resource checker with the given key has been proved
+    /// race-free before.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="key">Cache key</param>
+    public static bool IsRaceFree(string key)
+    {
+      Contract.Requires(key != null);
+      return File.Exists(VerdictCache.GetFileName(key, "racefree"));
+    }
+
+    /// <summary>
+    /// Stores that the per resource checker with the given key is race-free.
+    /// </summary>
+    /// <param name="key">Cache key</param>
+    public static void RegisterRaceFree(string key)
+    {
+      Contract.Requires(key != null);
+      VerdictCache.Write(VerdictCache.GetFileName(key, "racefree"), "");
+    }
+
+    #endregion
+
+    #region helper functions
+
+    private static void Write(string file, string text)
+    {
+      // The entry is written aside and moved in place, so that concurrent runs
+      // never see a partially written entry
+      var temp = file + "." + Guid.NewGuid().ToString("N");
+
+      try
+      {
+        Directory.CreateDirectory(WhoopRaceCheckerCommandLineOptions.Get().VerdictCache);
+        File.WriteAllText(temp, text);
+        if (!File.Exists(file))
+          File.Move(temp, file);
+      }
+      catch (IOException)
+      {
+        // Another run has stored the same entry in the meantime
+      }
+      finally
+      {
+        if (File.Exists(temp))
+          File.Delete(temp);
+      }
+    }
+
+    private static string ComputeHash(string text)
+    {
+      using (var sha = SHA1.Create())
+      {
+        var hash = sha.ComputeHash(Encoding.UTF8.GetBytes(text));
+        return BitConverter.ToString(hash).Replace("-", "").ToLower();
+      }
+    }
+
+    private static string GetFileName(string key, string extension)
+    {
+      return Path.Combine(WhoopRaceCheckerCommandLineOptions.Get().VerdictCache, key + "." + extension);
+    }
+
+    private static string Encode(string text)
+    {
+      return Convert.ToBase64String(Encoding.UTF8.GetBytes(text));
+    }
+
+    private static string Decode(string text)
+    {
+      return Encoding.UTF8.GetString(Convert.FromBase64String(text));
+    }
+
+    #endregion
+  }
+}
@@ -18,6 +18,13 @@ namespace Whoop
   internal class WhoopRaceCheckerCommandLineOptions : WhoopCommandLineOptions
   {
     public bool SkipRaceFreePairs = false;
+    public int ParallelPairs = 1;
+    public bool GroupPairs = false;
+    public bool OneVersusAll = false;
+    public int SplitResources = 0;
+    public int ProverPoolSize = 1;
+    public string VerdictCache = "";
+    public bool SliceCheckers = false;
     
     public WhoopRaceCheckerCommandLineOptions() : base("Whoop", "Whoop static lockset analyser")
     {
@@ -31,6 +38,62 @@ namespace Whoop
         this.SkipRaceFreePairs = true;
         return true;
       }
+
+      if (option == "parallelPairs")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.ParallelPairs = Int32.Parse(ps.args[ps.i]);
+          if (this.ParallelPairs < 1)
+            ps.Error("Invalid argument \"{0}\" to option {1}: must be at least 1", ps.args[ps.i], ps.s);
+        }
+        return true;
+      }
+
+      if (option == "groupPairs")
+      {
+        this.GroupPairs = true;
+        return true;
+      }
+
+      if (option == "oneVersusAll")
+      {
+        this.OneVersusAll = true;
+        return true;
+      }
+
+      if (option == "splitResources")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.SplitResources = Int32.Parse(ps.args[ps.i]);
+        }
+        return true;
+      }
+
+      if (option == "proverPoolSize")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.ProverPoolSize = Int32.Parse(ps.args[ps.i]);
+        }
+        return true;
+      }
+
+      if (option == "slicing")
+      {
+        this.SliceCheckers = true;
+        return true;
+      }
+
+      if (option == "verdictCache")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.VerdictCache = ps.args[ps.i];
+        }
+        return true;
+      }
       
       return base.ParseOption(option, ps);
     }
@@ -0,0 +1,167 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using Microsoft.Boogie;
+
+namespace Whoop.Analysis
+{
+  /// <summary>
+  /// Def-use index of an implementation, used by the pointer arithmetic analysis
+  /// instead of rescanning the implementation body for every identifier.
+  /// </summary>
+  internal sealed class DefUseIndex
+  {
+    #region fields
+
+    private Implementation Implementation;
+
+    private Dictionary<string, List<AssignCmd>> Definitions;
+    private Dictionary<string, Expr> LastDefinitions;
+    private Dictionary<string, List<CallCmd>> Allocations;
+    private bool IsIndexValid;
+
+    /// <summary>
+    /// Root pointers that have already been computed for identifiers of the
+    /// implementation. These survive invalidation of the def-use tables.
+    /// </summary>
+    internal Dictionary<IdentifierExpr, HashSet<Expr>> RootPointers;
+
+    private static readonly List<AssignCmd> NoDefinitions = new List<AssignCmd>();
+    private static readonly List<CallCmd> NoAllocations = new List<CallCmd>();
+
+    #endregion
+
+    #region public API
+
+    public DefUseIndex(Implementation impl)
+    {
+      Contract.Requires(impl != null);
+      this.Implementation = impl;
+
+      this.Definitions = new Dictionary<string, List<AssignCmd>>();
+      this.LastDefinitions = new Dictionary<string, Expr>();
+      this.Allocations = new Dictionary<string, List<CallCmd>>();
+      this.IsIndexValid = false;
+
+      this.RootPointers = new Dictionary<IdentifierExpr, HashSet<Expr>>();
+    }
+
+    /// <summary>
+    /// Marks the def-use tables as stale, so that they are rebuilt on the next
+    /// query. Computed root pointers are kept.
+    /// </summary>
+    public void InvalidateIndex()
+    {
+      this.IsIndexValid = false;
+    }
+
+    /// <summary>
+    /// Returns the assignments to the given variable, in block order and in
+    /// reverse command order inside each block.
+    /// </summary>
+    /// <returns>Assignments</returns>
+    /// <param name="name">Variable name</param>
+    public List<AssignCmd> GetDefinitions(string name)
+    {
+      this.EnsureIndex();
+
+      List<AssignCmd> definitions = null;
+      if (!this.Definitions.TryGetValue(name, out definitions))
+        return DefUseIndex.NoDefinitions;
+      return definitions;
+    }
+
+    /// <summary>
+    /// Returns the right hand side of the last assignment to the given variable,
+    /// or null if the variable is never assigned.
+    /// </summary>
+    /// <returns>Expression</returns>
+    /// <param name="name">Variable name</param>
+    public Expr GetLastDefinition(string name)
+    {
+      this.EnsureIndex();
+
+      Expr definition = null;
+      this.LastDefinitions.TryGetValue(name, out definition);
+      return definition;
+    }
+
+    /// <summary>
+    /// Returns the $alloca calls that allocate the given variable.
+    /// </summary>
+    /// <returns>Calls</returns>
+    /// <param name="name">Variable name</param>
+    public List<CallCmd> GetAllocations(string name)
+    {
+      this.EnsureIndex();
+
+      List<CallCmd> allocations = null;
+      if (!this.Allocations.TryGetValue(name, out allocations))
+        return DefUseIndex.NoAllocations;
+      return allocations;
+    }
+
+    #endregion
+
+    #region index construction
+
+    private void EnsureIndex()
+    {
+      if (this.IsIndexValid)
+        return;
+
+      this.Definitions.Clear();
+      this.LastDefinitions.Clear();
+      this.Allocations.Clear();
+
+      var definedInBlock = new HashSet<string>();
+      foreach (var block in this.Implementation.Blocks)
+      {
+        definedInBlock.Clear();
+        for (int i = block.Cmds.Count - 1; i >= 0; i--)
+        {
+          if (block.Cmds[i] is AssignCmd)
+          {
+            var assign = block.Cmds[i] as AssignCmd;
+            var name = assign.Lhss[0].DeepAssignedIdentifier.Name;
+
+            if (!this.Definitions.ContainsKey(name))
+              this.Definitions.Add(name, new List<AssignCmd>());
+            this.Definitions[name].Add(assign);
+
+            // Later blocks override earlier ones, so the last assignment of the
+            // implementation wins.
+            if (definedInBlock.Add(name))
+              this.LastDefinitions[name] = assign.Rhss[0];
+          }
+          else if (block.Cmds[i] is CallCmd)
+          {
+            var call = block.Cmds[i] as CallCmd;
+            if (!call.callee.Equals("$alloca"))
+              continue;
+
+            var name = call.Outs[0].Name;
+            if (!this.Allocations.ContainsKey(name))
+              this.Allocations.Add(name, new List<CallCmd>());
+            this.Allocations[name].Add(call);
+          }
+        }
+      }
+
+      this.IsIndexValid = true;
+    }
+
+    #endregion
+  }
+}
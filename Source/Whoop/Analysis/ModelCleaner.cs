@@ -293,6 +293,7 @@ namespace Whoop.Analysis
     public static void RemoveUnecesseryInfoFromSpecialFunctions(AnalysisContext ac)
     {
       var toRemove = new List<string>();
+      var toStrip = new List<Procedure>();
 
       foreach (var proc in ac.TopLevelDeclarations.OfType<Procedure>())
       {
@@ -312,12 +313,20 @@ namespace Whoop.Analysis
           proc.Name.Equals("misc_register") || proc.Name.Equals("misc_deregister") ||
           proc.Name.Equals("nfc_register_device") || proc.Name.Equals("nfc_free_device")))
           continue;
-        proc.Modifies.Clear();
-        proc.Requires.Clear();
-        proc.Ensures.Clear();
+        toStrip.Add(proc);
         toRemove.Add(proc.Name);
       }
 
+      // The procedures can be shared with other analysis contexts, so they are
+      // replaced by stripped copies instead of being stripped in place
+      foreach (var proc in toStrip)
+      {
+        var stripped = new Procedure(proc.tok, proc.Name, proc.TypeParameters,
+          proc.InParams, proc.OutParams, new List<Requires>(),
+          new List<IdentifierExpr>(), new List<Ensures>(), proc.Attributes);
+        ac.TopLevelDeclarations[ac.TopLevelDeclarations.IndexOf(proc)] = stripped;
+      }
+
       foreach (var str in toRemove)
       {
         ac.TopLevelDeclarations.RemoveAll(val => (val is Implementation) &&
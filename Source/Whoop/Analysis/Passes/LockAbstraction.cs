@@ -60,6 +60,7 @@ namespace Whoop.Analysis
     private void IdentifyAndCreateUniqueLocks()
     {
       var initialImpl = this.AC.GetImplementation(DeviceDriver.InitEntryPoint);
+      var index = new DefUseIndex(initialImpl);
 
       foreach (var block in initialImpl.Blocks)
       {
@@ -71,7 +72,7 @@ namespace Whoop.Analysis
             !(block.Cmds[idx] as CallCmd).callee.Contains("spin_lock_init"))
             continue;
 
-          Expr lockExpr = PointerArithmeticAnalyser.ComputeRootPointer(initialImpl,
+          Expr lockExpr = PointerArithmeticAnalyser.ComputeRootPointer(index,
             block.Label, (block.Cmds[idx] as CallCmd).Ins[0]);
 
           Lock newLock = new Lock(new Constant(Token.NoToken,
@@ -84,7 +85,7 @@ namespace Whoop.Analysis
         }
       }
 
-      foreach (var l in AnalysisContext.GlobalLocks)
+      foreach (var l in AnalysisSession.Current.GetGlobalLocks())
       {
         if (!this.AC.Locks.Any(val => val.Id.Name.Equals(l.Id.Name)))
         {
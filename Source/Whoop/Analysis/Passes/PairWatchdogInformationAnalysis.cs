@@ -79,37 +79,37 @@ namespace Whoop.Analysis
         var otherRegion = otherAc.InstrumentationRegions.Find(val =>
           val.Implementation().Name.Equals(pairEp.Name));
  
-        var accessMatch = new Dictionary<string, Expr>();
-        var ep1Accesses = new HashSet<string>();
+        var accessMatch = new Dictionary<ExprKey, Expr>();
+        var ep1Accesses = new HashSet<ExprKey>();
         foreach (var resource in this.Region.GetResourceAccesses())
         {
           foreach (var access in resource.Value)
           {
             Expr a = null;
             pairRegion.TryGetMatchedAccess(this.EP, access, out a);
-            ep1Accesses.Add(a.ToString());
-            accessMatch.Add(a.ToString(), access);
+            ep1Accesses.Add(ExprKey.Of(a));
+            accessMatch.Add(ExprKey.Of(a), access);
           }
         }
 
         if (ep1Accesses.Count == 0)
           return;
 
-        var ep2Accesses = new HashSet<string>();
+        var ep2Accesses = new HashSet<ExprKey>();
         foreach (var resource in otherRegion.GetResourceAccesses())
         {
           foreach (var access in resource.Value)
           {
             Expr a = null;
             pairRegion.TryGetMatchedAccess(pairEp, access, out a);
-            ep2Accesses.Add(a.ToString());
+            ep2Accesses.Add(ExprKey.Of(a));
           }
         }
 
         if (ep2Accesses.Count == 0)
           continue;
 
-        var intersection = new HashSet<string>(ep1Accesses.Intersect(ep2Accesses));
+        var intersection = new HashSet<ExprKey>(ep1Accesses.Intersect(ep2Accesses));
         foreach (var access in intersection)
           this.PairAccesses.Add(accessMatch[access]);
       }
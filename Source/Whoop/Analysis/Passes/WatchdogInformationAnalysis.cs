@@ -32,6 +32,11 @@ namespace Whoop.Analysis
 
     private Dictionary<InstrumentationRegion, PointerArithmeticAnalyser> PtrAnalysisCache;
 
+    private Dictionary<string, InstrumentationRegion> RegionMap;
+    private Graph<InstrumentationRegion> RegionCallGraph;
+    private List<InstrumentationRegion> OrderedRegions;
+    private Dictionary<InstrumentationRegion, int> RegionOrder;
+
     public WatchdogInformationAnalysis(AnalysisContext ac, EntryPoint ep)
     {
       Contract.Requires(ac != null && ep != null);
@@ -39,6 +44,11 @@ namespace Whoop.Analysis
       this.EP = ep;
 
       this.PtrAnalysisCache = new Dictionary<InstrumentationRegion, PointerArithmeticAnalyser>();
+
+      this.RegionMap = new Dictionary<string, InstrumentationRegion>();
+      this.RegionCallGraph = new Graph<InstrumentationRegion>();
+      this.OrderedRegions = new List<InstrumentationRegion>();
+      this.RegionOrder = new Dictionary<InstrumentationRegion, int>();
     }
 
     public void Run()
@@ -50,6 +60,7 @@ namespace Whoop.Analysis
       }
 
       this.AnalyseLocalAccessesInRegions();
+      this.ComputeRegionOrder();
       this.IdentifyCallAccessesInRegions();
       this.AnalyseCallAccessesInRegions();
       this.MapAxiomAccessesInRegions();
@@ -81,36 +92,68 @@ namespace Whoop.Analysis
       }
     }
 
+    /// <summary>
+    /// Computes the regions that access resources through their calls. Regions are
+    /// visited callees first, and a region is only revisited if one of its callees
+    /// stopped accessing resources.
+    /// </summary>
     private void IdentifyCallAccessesInRegions()
     {
-      var fixpoint = true;
-      foreach (var region in this.AC.InstrumentationRegions)
+      var worklist = new SortedSet<int>(Enumerable.Range(0, this.OrderedRegions.Count));
+      while (worklist.Count > 0)
       {
+        var region = this.OrderedRegions[worklist.Min];
+        worklist.Remove(worklist.Min);
+
         if (region.IsNotAccessingResources)
           continue;
+        if (this.IdentifyCallAccessesInRegion(region))
+          continue;
 
-        fixpoint = this.IdentifyCallAccessesInRegion(region) && fixpoint;
-      }
-
-      if (!fixpoint)
-      {
-        this.IdentifyCallAccessesInRegions();
+        foreach (var caller in this.RegionCallGraph.Predecessors(region))
+          worklist.Add(this.RegionOrder[caller]);
       }
     }
 
+    /// <summary>
+    /// Propagates accesses between callers and callees until a fixpoint is reached.
+    /// Regions are visited callees first, and the callers of a region are only
+    /// revisited if the accesses of the region changed.
+    /// </summary>
     private void AnalyseCallAccessesInRegions()
     {
-      var fixpoint = true;
-      foreach (var region in this.AC.InstrumentationRegions)
+      var worklist = new SortedSet<int>(Enumerable.Range(0, this.OrderedRegions.Count));
+      var accessCounts = new Dictionary<InstrumentationRegion, int>();
+
+      while (worklist.Count > 0)
       {
+        var region = this.OrderedRegions[worklist.Min];
+        worklist.Remove(worklist.Min);
+
         if (region.IsNotAccessingResources)
           continue;
-        fixpoint = this.AnalyseCallAccessesInRegion(region) && fixpoint;
-      }
 
-      if (!fixpoint)
-      {
-        this.AnalyseCallAccessesInRegions();
+        // The region receives accesses from its callees and passes its own accesses
+        // down to them, so both sides can change.
+        accessCounts.Clear();
+        accessCounts.Add(region, this.CountResourceAccesses(region));
+        foreach (var callee in this.RegionCallGraph.Successors(region))
+        {
+          if (!accessCounts.ContainsKey(callee))
+            accessCounts.Add(callee, this.CountResourceAccesses(callee));
+        }
+
+        this.AnalyseCallAccessesInRegion(region);
+
+        foreach (var pair in accessCounts)
+        {
+          if (this.CountResourceAccesses(pair.Key) == pair.Value)
+            continue;
+
+          worklist.Add(this.RegionOrder[pair.Key]);
+          foreach (var caller in this.RegionCallGraph.Predecessors(pair.Key))
+            worklist.Add(this.RegionOrder[caller]);
+        }
       }
     }
 
@@ -123,7 +166,7 @@ namespace Whoop.Analysis
 
         foreach (var resource in this.AC.AxiomAccessesMap)
         {
-          foreach (var access in resource.Value)
+          foreach (var access in resource.Value.Values)
           {
             region.TryAddAxiomResourceAccesses(resource.Key, access);
           }
@@ -185,11 +228,7 @@ namespace Whoop.Analysis
               }
               else if (this.PtrAnalysisCache[region].IsAxiom(id))
               {
-                if (!this.AC.AxiomAccessesMap.ContainsKey(resource))
-                  this.AC.AxiomAccessesMap.Add(resource, new HashSet<Expr>());
-                if (!this.AC.AxiomAccessesMap[resource].Any(val =>
-                  val.ToString().Equals(ptrExpr.ToString())))
-                  this.AC.AxiomAccessesMap[resource].Add(ptrExpr);
+                this.TryAddAxiomAccess(resource, ptrExpr);
                 region.TryAddLocalResourceAccess(resource, ptrExpr);
               }
               else
@@ -232,8 +271,7 @@ namespace Whoop.Analysis
           {
             numberOfCalls++;
 
-            var calleeRegion = this.AC.InstrumentationRegions.Find(val =>
-              val.Implementation().Name.Equals(call.callee));
+            var calleeRegion = this.GetRegion(call.callee);
             if (calleeRegion == null)
             {
               numberOfNonCheckedCalls++;
@@ -298,20 +336,11 @@ namespace Whoop.Analysis
       return true;
     }
 
-    private bool AnalyseCallAccessesInRegion(InstrumentationRegion region)
+    private void AnalyseCallAccessesInRegion(InstrumentationRegion region)
     {
-      int preCount = 0;
-      int afterCount = 0;
-
-      foreach (var r in region.GetResourceAccesses())
-      {
-        preCount = preCount + r.Value.Count;
-      }
-
       foreach (var call in region.CallInformation.Keys)
       {
-        var calleeRegion = this.AC.InstrumentationRegions.Find(val =>
-          val.Implementation().Name.Equals(call.callee));
+        var calleeRegion = this.GetRegion(call.callee);
         if (calleeRegion.IsNotAccessingResources)
           continue;
 
@@ -342,13 +371,7 @@ namespace Whoop.Analysis
             var id = this.PtrAnalysisCache[region].GetIdentifier(computedExpr);
             if (this.PtrAnalysisCache[region].IsAxiom(id))
             {
-              if (!this.AC.AxiomAccessesMap.ContainsKey(r.Key))
-                this.AC.AxiomAccessesMap.Add(r.Key, new HashSet<Expr>());
-              if (!this.AC.AxiomAccessesMap[r.Key].Any(val =>
-                val.ToString().Equals(computedExpr.ToString())))
-              {
-                this.AC.AxiomAccessesMap[r.Key].Add(computedExpr);
-              }
+              this.TryAddAxiomAccess(r.Key, computedExpr);
             }
             else
             {
@@ -380,33 +403,94 @@ namespace Whoop.Analysis
               if (mappedExpr != null)
               {
                 this.CacheMatchedAccesses(pair.Key, access, mappedExpr);
-                if (calleeRegion.TryAddExternalResourceAccesses(pair.Key, mappedExpr))
-                  afterCount++;
+                calleeRegion.TryAddExternalResourceAccesses(pair.Key, mappedExpr);
               }
             }
           }
         }
       }
+    }
 
-      foreach (var r in region.GetResourceAccesses())
+    #endregion
+
+    #region helper functions
+
+    /// <summary>
+    /// Builds the call graph between regions and orders the regions in reverse
+    /// topological order of that graph, keeping regions of the same strongly
+    /// connected component next to each other.
+    /// </summary>
+    private void ComputeRegionOrder()
+    {
+      foreach (var region in this.AC.InstrumentationRegions)
       {
-        afterCount = afterCount + r.Value.Count;
+        if (!this.RegionMap.ContainsKey(region.Implementation().Name))
+          this.RegionMap.Add(region.Implementation().Name, region);
       }
 
-      if (preCount != afterCount) return false;
-      else return true;
+      foreach (var region in this.AC.InstrumentationRegions)
+      {
+        foreach (var block in region.Implementation().Blocks)
+        {
+          foreach (var call in block.Cmds.OfType<CallCmd>())
+          {
+            var calleeRegion = this.GetRegion(call.callee);
+            if (calleeRegion == null)
+              continue;
+            this.RegionCallGraph.AddEdge(region, calleeRegion);
+          }
+        }
+      }
+
+      var position = new Dictionary<InstrumentationRegion, int>();
+      foreach (var region in this.AC.InstrumentationRegions)
+      {
+        if (!position.ContainsKey(region))
+          position.Add(region, position.Count);
+      }
+
+      foreach (var component in this.RegionCallGraph.ComputeStronglyConnectedComponents())
+      {
+        foreach (var region in component.OrderBy(val => position[val]))
+          this.AddToRegionOrder(region);
+      }
+
+      foreach (var region in this.AC.InstrumentationRegions)
+      {
+        this.AddToRegionOrder(region);
+      }
     }
 
-    #endregion
+    private void AddToRegionOrder(InstrumentationRegion region)
+    {
+      if (this.RegionOrder.ContainsKey(region))
+        return;
+      this.RegionOrder.Add(region, this.OrderedRegions.Count);
+      this.OrderedRegions.Add(region);
+    }
 
-    #region helper functions
+    private InstrumentationRegion GetRegion(string name)
+    {
+      InstrumentationRegion region = null;
+      this.RegionMap.TryGetValue(name, out region);
+      return region;
+    }
+
+    private int CountResourceAccesses(InstrumentationRegion region)
+    {
+      int count = 0;
+      foreach (var r in region.GetResourceAccesses())
+        count = count + r.Value.Count;
+      return count;
+    }
 
     private int TryGetArgumentIndex(CallCmd call, IRegion callRegion, Expr access)
     {
       int index = -1;
       for (int idx = 0; idx < callRegion.Implementation().InParams.Count; idx++)
       {
-        if (callRegion.Implementation().InParams[idx].ToString().Equals(access.ToString()))
+        if (access is IdentifierExpr && callRegion.Implementation().InParams[idx].Name.
+          Equals((access as IdentifierExpr).Name))
         {
           index = idx;
           break;
@@ -481,7 +565,7 @@ namespace Whoop.Analysis
         var la = localAccess as NAryExpr;
         var pe = ptrExpr as NAryExpr;
 
-        if (!la.Args[0].ToString().Equals(pe.Args[0].ToString()))
+        if (ExprKey.Of(la.Args[0]) != ExprKey.Of(pe.Args[0]))
           return result;
 
         int l = (la.Args[1] as LiteralExpr).asBigNum.ToInt;
@@ -499,7 +583,7 @@ namespace Whoop.Analysis
       {
         var la = localAccess as NAryExpr;
 
-        if (!la.Args[0].ToString().Equals(ptrExpr.ToString()))
+        if (ExprKey.Of(la.Args[0]) != ExprKey.Of(ptrExpr))
           return result;
 
         int l = (la.Args[1] as LiteralExpr).asBigNum.ToInt;
@@ -509,7 +593,7 @@ namespace Whoop.Analysis
       {
         var pe = ptrExpr as NAryExpr;
 
-        if (!localAccess.ToString().Equals(pe.Args[0].ToString()))
+        if (ExprKey.Of(localAccess) != ExprKey.Of(pe.Args[0]))
           return result;
 
         int r = (pe.Args[1] as LiteralExpr).asBigNum.ToInt;
@@ -518,7 +602,7 @@ namespace Whoop.Analysis
       }
       else if (ptrExpr is IdentifierExpr)
       {
-        if (!localAccess.ToString().Equals(ptrExpr.ToString()))
+        if (ExprKey.Of(localAccess) != ExprKey.Of(ptrExpr))
           return result;
         result = ce;
       }
@@ -529,6 +613,16 @@ namespace Whoop.Analysis
       return result;
     }
 
+    private void TryAddAxiomAccess(string resource, Expr access)
+    {
+      if (!this.AC.AxiomAccessesMap.ContainsKey(resource))
+        this.AC.AxiomAccessesMap.Add(resource, new Dictionary<ExprKey, Expr>());
+
+      var key = ExprKey.Of(access);
+      if (!this.AC.AxiomAccessesMap[resource].ContainsKey(key))
+        this.AC.AxiomAccessesMap[resource].Add(key, access);
+    }
+
     private void CacheMatchedAccesses(string resource, Expr expr1, Expr expr2)
     {
       string str1 = expr1.ToString();
@@ -31,7 +31,6 @@ namespace Whoop.Analysis
     private AnalysisContext AC;
     private EntryPoint EP;
     private Implementation Implementation;
-    private List<Variable> InParams;
 
     private bool Optimise;
 
@@ -39,8 +38,9 @@ namespace Whoop.Analysis
     private Dictionary<IdentifierExpr, HashSet<Expr>> AssignmentMap;
     private Dictionary<IdentifierExpr, HashSet<CallCmd>> CallMap;
 
-    private static Dictionary<EntryPoint, Dictionary<Implementation, Dictionary<IdentifierExpr, HashSet<Expr>>>> Cache =
-      new Dictionary<EntryPoint, Dictionary<Implementation, Dictionary<IdentifierExpr, HashSet<Expr>>>>();
+    private DefUseIndex Index;
+    private HashSet<string> InParamNames;
+    private HashSet<string> AxiomNames;
 
     private enum ArithmeticOperation
     {
@@ -70,7 +70,6 @@ namespace Whoop.Analysis
       this.AC = ac;
       this.EP = ep;
       this.Implementation = impl;
-      this.InParams = impl.InParams;
 
       this.Optimise = optimise;
 
@@ -78,12 +77,13 @@ namespace Whoop.Analysis
       this.AssignmentMap = new Dictionary<IdentifierExpr, HashSet<Expr>>();
       this.CallMap = new Dictionary<IdentifierExpr, HashSet<CallCmd>>();
 
-      if (!PointerArithmeticAnalyser.Cache.ContainsKey(ep))
-        PointerArithmeticAnalyser.Cache.Add(ep,
-          new Dictionary<Implementation, Dictionary<IdentifierExpr, HashSet<Expr>>>());
-      if (!PointerArithmeticAnalyser.Cache[ep].ContainsKey(impl))
-        PointerArithmeticAnalyser.Cache[ep].Add(impl,
-          new Dictionary<IdentifierExpr, HashSet<Expr>>());
+      // The implementation might have changed since the index was last used, so
+      // the def-use tables are rebuilt, while computed root pointers are kept.
+      this.Index = AnalysisSession.Current.GetDefUseIndex(ep, impl);
+      this.Index.InvalidateIndex();
+
+      this.InParamNames = new HashSet<string>(impl.InParams.Select(val => val.Name));
+      this.AxiomNames = null;
     }
 
     /// <summary>
@@ -119,7 +119,7 @@ namespace Whoop.Analysis
       }
 
       var identifier = id as IdentifierExpr;
-      if (this.InParams.Any(val => val.Name.Equals(identifier.Name)))
+      if (this.InParamNames.Contains(identifier.Name))
       {
         ptrExprs.Add(Expr.Add(identifier, new LiteralExpr(Token.NoToken, BigNum.FromInt(0))));
         return ResultType.Pointer;
@@ -130,9 +130,9 @@ namespace Whoop.Analysis
         return ResultType.Axiom;
       }
 
-      if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(identifier))
+      if (this.Index.RootPointers.ContainsKey(identifier))
       {
-        ptrExprs = PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][identifier];
+        ptrExprs = this.Index.RootPointers[identifier];
         return ResultType.Pointer;
       }
 
@@ -153,32 +153,31 @@ namespace Whoop.Analysis
         }
       }
 
-      ptrExprs = PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][identifier];
+      ptrExprs = this.Index.RootPointers[identifier];
       return ResultType.Pointer;
     }
 
     public bool IsAxiom(IdentifierExpr expr)
     {
-      bool result = false;
       if (expr == null)
-        return result;
+        return false;
 
-      foreach (var axiom in this.AC.TopLevelDeclarations.OfType<Axiom>())
+      if (this.AxiomNames == null)
       {
-        Expr axiomExpr = null;
-        if (axiom.Expr is NAryExpr)
-          axiomExpr = (axiom.Expr as NAryExpr).Args[0];
-        else
-          axiomExpr = axiom.Expr;
-
-        if (axiomExpr.ToString().Equals(expr.Name))
+        this.AxiomNames = new HashSet<string>();
+        foreach (var axiom in this.AC.TopLevelDeclarations.OfType<Axiom>())
         {
-          result = true;
-          break;
+          Expr axiomExpr = null;
+          if (axiom.Expr is NAryExpr)
+            axiomExpr = (axiom.Expr as NAryExpr).Args[0];
+          else
+            axiomExpr = axiom.Expr;
+
+          this.AxiomNames.Add(axiomExpr.ToString());
         }
       }
 
-      return result;
+      return this.AxiomNames.Contains(expr.Name);
     }
 
     public IdentifierExpr GetIdentifier(Expr expr)
@@ -204,6 +203,20 @@ namespace Whoop.Analysis
     /// <param name="id">Identifier expression</param>
     public static Expr ComputeRootPointer(Implementation impl, string label, Expr id)
     {
+      Contract.Requires(impl != null);
+      return PointerArithmeticAnalyser.ComputeRootPointer(new DefUseIndex(impl), label, id);
+    }
+
+    /// <summary>
+    /// Compute $pa(p, i, s) == p + i * s);
+    /// </summary>
+    /// <returns>The root pointer.</returns>
+    /// <param name="index">Def-use index of the implementation</param>
+    /// <param name="label">Root block label</param>
+    /// <param name="id">Identifier expression</param>
+    public static Expr ComputeRootPointer(DefUseIndex index, string label, Expr id)
+    {
+      Contract.Requires(index != null);
       if (id is LiteralExpr) return id;
       if (id is NAryExpr && (id as NAryExpr).Args.Count == 1 &&
         (id as NAryExpr).Fun.FunctionName.Equals("-"))
@@ -211,7 +224,7 @@ namespace Whoop.Analysis
         return id;
       }
 
-      NAryExpr root = PointerArithmeticAnalyser.GetPointerArithmeticExpr(impl, id) as NAryExpr;
+      NAryExpr root = PointerArithmeticAnalyser.GetPointerArithmeticExpr(index, id) as NAryExpr;
       if (root == null) return id;
 
       Expr result = root;
@@ -240,11 +253,9 @@ namespace Whoop.Analysis
             return id;
           }
 
-          if (alreadyVisited.Any(v => v.Item1.Equals(label) && v.Item2.Equals(result)))
+          if (!alreadyVisited.Add(new Tuple<string, Expr>(label, result)))
             return id;
 
-          alreadyVisited.Add(new Tuple<string, Expr>(label, result));
-
           if (PointerArithmeticAnalyser.IsArithmeticExpression(result as NAryExpr))
             return id;
 
@@ -265,7 +276,7 @@ namespace Whoop.Analysis
         }
         else
         {
-          resolution = PointerArithmeticAnalyser.GetPointerArithmeticExpr(impl, result);
+          resolution = PointerArithmeticAnalyser.GetPointerArithmeticExpr(index, result);
           if (resolution != null) result = resolution;
         }
       }
@@ -276,6 +287,13 @@ namespace Whoop.Analysis
 
     public static Expr GetPointerArithmeticExpr(Implementation impl, Expr expr)
     {
+      Contract.Requires(impl != null);
+      return PointerArithmeticAnalyser.GetPointerArithmeticExpr(new DefUseIndex(impl), expr);
+    }
+
+    public static Expr GetPointerArithmeticExpr(DefUseIndex index, Expr expr)
+    {
+      Contract.Requires(index != null);
       if (expr is LiteralExpr)
         return null;
 
@@ -283,20 +301,7 @@ namespace Whoop.Analysis
       if (identifier == null)
         return null;
 
-      for (int i = impl.Blocks.Count - 1; i >= 0; i--)
-      {
-        for (int j = impl.Blocks[i].Cmds.Count - 1; j >= 0; j--)
-        {
-          Cmd cmd = impl.Blocks[i].Cmds[j];
-          if (!(cmd is AssignCmd))
-            continue;
-          if (!((cmd as AssignCmd).Lhss[0].DeepAssignedIdentifier.Name.Equals(identifier.Name)))
-            continue;
-          return (cmd as AssignCmd).Rhss[0];
-        }
-      }
-
-      return null;
+      return index.GetLastDefinition(identifier.Name);
     }
 
     public static Expr ComputeLiteralsInExpr(Expr expr)
@@ -320,7 +325,7 @@ namespace Whoop.Analysis
 
     private void ComputeMapsForIdentifierExpr(IdentifierExpr id)
     {
-      if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(id))
+      if (this.Index.RootPointers.ContainsKey(id))
         return;
 
       if (!this.ExpressionMap.ContainsKey(id))
@@ -330,45 +335,28 @@ namespace Whoop.Analysis
       if (!this.CallMap.ContainsKey(id))
         this.CallMap.Add(id, new HashSet<CallCmd>());
 
-      foreach (var block in this.Implementation.Blocks)
+      foreach (var assign in this.Index.GetDefinitions(id.Name))
       {
-        for (int i = block.Cmds.Count - 1; i >= 0; i--)
-        {
-          if (block.Cmds[i] is AssignCmd)
-          {
-            var assign = block.Cmds[i] as AssignCmd;
-            if (!assign.Lhss[0].DeepAssignedIdentifier.Name.Equals(id.Name))
-              continue;
-            if (this.AssignmentMap[id].Contains(assign.Rhss[0]))
-              continue;
-
-            var expr = assign.Rhss[0];
-            PointerArithmeticAnalyser.TryPerformCast(ref expr);
-            this.AssignmentMap[id].Add(expr);
-
-            if (expr.ToString().StartsWith("$pa("))
-              this.ExpressionMap[id].Add(expr, 0);
-            if (expr is IdentifierExpr && this.InParams.Any(val =>
-              val.Name.Equals((expr as IdentifierExpr).Name)))
-              this.ExpressionMap[id].Add(expr, 0);
-            if (expr is IdentifierExpr && this.AC.TopLevelDeclarations.OfType<Constant>().
-              Any(val => val.Name.Equals((expr as IdentifierExpr).Name)))
-              this.ExpressionMap[id].Add(expr, 0);
-            if (expr is LiteralExpr)
-              this.ExpressionMap[id].Add(expr, 0);
-          }
-          else if (block.Cmds[i] is CallCmd)
-          {
-            var call = block.Cmds[i] as CallCmd;
-            if (call.callee.Equals("$alloca"))
-            {
-              if (!call.Outs[0].Name.Equals(id.Name))
-                continue;
+        if (this.AssignmentMap[id].Contains(assign.Rhss[0]))
+          continue;
 
-              this.CallMap[id].Add(call);
-            }
-          }
-        }
+        var expr = assign.Rhss[0];
+        PointerArithmeticAnalyser.TryPerformCast(ref expr);
+        this.AssignmentMap[id].Add(expr);
+
+        if (expr is NAryExpr && (expr as NAryExpr).Fun.FunctionName.Equals("$pa"))
+          this.ExpressionMap[id].Add(expr, 0);
+        if (expr is IdentifierExpr && this.InParamNames.Contains((expr as IdentifierExpr).Name))
+          this.ExpressionMap[id].Add(expr, 0);
+        if (expr is IdentifierExpr && this.AC.GetConstant((expr as IdentifierExpr).Name) != null)
+          this.ExpressionMap[id].Add(expr, 0);
+        if (expr is LiteralExpr)
+          this.ExpressionMap[id].Add(expr, 0);
+      }
+
+      foreach (var call in this.Index.GetAllocations(id.Name))
+      {
+        this.CallMap[id].Add(call);
       }
     }
 
@@ -376,7 +364,7 @@ namespace Whoop.Analysis
     {
       foreach (var id in identifiers.Keys.ToList())
       {
-        if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(id))
+        if (this.Index.RootPointers.ContainsKey(id))
           continue;
         if (identifiers[id]) continue;
 
@@ -395,13 +383,13 @@ namespace Whoop.Analysis
 
           if (identifiers.ContainsKey(exprId) && identifiers[exprId])
             continue;
-          if (this.InParams.Any(val => val.Name.Equals(exprId.Name)))
+          if (this.InParamNames.Contains(exprId.Name))
             continue;
-          if (this.AC.TopLevelDeclarations.OfType<Constant>().Any(val => val.Name.Equals(exprId.Name)))
+          if (this.AC.GetConstant(exprId.Name) != null)
             continue;
 
           this.ComputeMapsForIdentifierExpr(exprId);
-          if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(exprId) &&
+          if (this.Index.RootPointers.ContainsKey(exprId) &&
             !identifiers.ContainsKey(exprId))
           {
             identifiers.Add(exprId, true);
@@ -419,11 +407,11 @@ namespace Whoop.Analysis
 
           if (identifiers.ContainsKey(exprId) && identifiers[exprId])
             continue;
-          if (this.InParams.Any(val => val.Name.Equals(exprId.Name)))
+          if (this.InParamNames.Contains(exprId.Name))
             continue;
 
           this.ComputeMapsForIdentifierExpr(exprId);
-          if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(exprId) &&
+          if (this.Index.RootPointers.ContainsKey(exprId) &&
             !identifiers.ContainsKey(exprId))
           {
             identifiers.Add(exprId, true);
@@ -443,23 +431,23 @@ namespace Whoop.Analysis
     {
       foreach (var identifier in this.ExpressionMap)
       {
-        if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(identifier.Key))
+        if (this.Index.RootPointers.ContainsKey(identifier.Key))
           continue;
 
-        PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].Add(identifier.Key, new HashSet<Expr>());
+        this.Index.RootPointers.Add(identifier.Key, new HashSet<Expr>());
         foreach (var pair in identifier.Value)
         {
           if (pair.Key is LiteralExpr)
           {
-            PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][identifier.Key].Add(
+            this.Index.RootPointers[identifier.Key].Add(
               Expr.Add(pair.Key, new LiteralExpr(Token.NoToken, BigNum.FromInt(pair.Value))));
           }
           else if (pair.Key is IdentifierExpr)
           {
             var id = pair.Key as IdentifierExpr;
-            if (this.InParams.Any(val => val.Name.Equals(id.Name)))
+            if (this.InParamNames.Contains(id.Name))
             {
-              PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][identifier.Key].Add(
+              this.Index.RootPointers[identifier.Key].Add(
                 Expr.Add(id, new LiteralExpr(Token.NoToken, BigNum.FromInt(pair.Value))));
             }
             else
@@ -469,7 +457,7 @@ namespace Whoop.Analysis
               this.MatchExpressions(outcome, identifier.Key, id, pair.Value, alreadyMatched);
               foreach (var expr in outcome)
               {
-                PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][identifier.Key].Add(expr);
+                this.Index.RootPointers[identifier.Key].Add(expr);
               }
             }
           }
@@ -481,7 +469,7 @@ namespace Whoop.Analysis
     {
       foreach (var identifier in this.AssignmentMap)
       {
-        if (!PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(identifier.Key))
+        if (!this.Index.RootPointers.ContainsKey(identifier.Key))
           continue;
 
         foreach (var expr in identifier.Value)
@@ -489,13 +477,13 @@ namespace Whoop.Analysis
           if (!(expr is IdentifierExpr))continue;
           var exprId = expr as IdentifierExpr;
           if (!exprId.Name.StartsWith("$p")) continue;
-          if (!PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(exprId))
+          if (!this.Index.RootPointers.ContainsKey(exprId))
             continue;
 
-          var results = PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][exprId];
+          var results = this.Index.RootPointers[exprId];
           foreach (var res in results)
           {
-            PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][identifier.Key].Add(res);
+            this.Index.RootPointers[identifier.Key].Add(res);
           }
         }
       }
@@ -509,9 +497,9 @@ namespace Whoop.Analysis
         return;
 
       alreadyMatched.Add(new Tuple<IdentifierExpr, IdentifierExpr>(lhs, rhs));
-      if (PointerArithmeticAnalyser.Cache[this.EP][this.Implementation].ContainsKey(rhs))
+      if (this.Index.RootPointers.ContainsKey(rhs))
       {
-        var results = PointerArithmeticAnalyser.Cache[this.EP][this.Implementation][rhs];
+        var results = this.Index.RootPointers[rhs];
         foreach (var r in results)
         {
           var arg = (r as NAryExpr).Args[0];
@@ -528,14 +516,14 @@ namespace Whoop.Analysis
             continue;
 
           var id = pair.Key as IdentifierExpr;
-          if (this.InParams.Any(val => val.Name.Equals(id.Name)))
+          if (this.InParamNames.Contains(id.Name))
           {
             var result = Expr.Add(id, new LiteralExpr(Token.NoToken, BigNum.FromInt(pair.Value + value)));
             if (outcome.Contains(result))
               return;
             outcome.Add(result);
           }
-          else if (this.AC.TopLevelDeclarations.OfType<Constant>().Any(val => val.Name.Equals(id.Name)))
+          else if (this.AC.GetConstant(id.Name) != null)
           {
             var result = Expr.Add(id, new LiteralExpr(Token.NoToken, BigNum.FromInt(pair.Value + value)));
             if (outcome.Contains(result))
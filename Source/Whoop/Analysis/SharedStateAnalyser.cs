@@ -24,18 +24,9 @@ namespace Whoop.Analysis
 {
   public static class SharedStateAnalyser
   {
-    private static List<Implementation> AlreadyAnalyzedFunctions =
-      new List<Implementation>();
-
-    private static Dictionary<EntryPoint, List<Variable>> EntryPointMemoryRegions =
-      new Dictionary<EntryPoint, List<Variable>>();
-
-    private static Dictionary<Implementation, List<Variable>> MemoryRegions =
-      new Dictionary<Implementation, List<Variable>>();
-
     public static List<Variable> GetMemoryRegions(EntryPoint ep)
     {
-      return SharedStateAnalyser.EntryPointMemoryRegions[ep];
+      return AnalysisSession.Current.EntryPointMemoryRegions[ep];
     }
 
     public static List<Variable> GetPairMemoryRegions(EntryPoint ep1, EntryPoint ep2)
@@ -55,7 +46,7 @@ namespace Whoop.Analysis
 
     public static List<Variable> GetMemoryRegions(string name)
     {
-      foreach (var mr in SharedStateAnalyser.MemoryRegions)
+      foreach (var mr in AnalysisSession.Current.MemoryRegions)
       {
         if (!mr.Key.Name.Equals(name))
           continue;
@@ -109,6 +100,37 @@ namespace Whoop.Analysis
       return false;
     }
 
+    /// <summary>
+    /// Checks if the footprints of the entry points of the given pair conflict, i.e.
+    /// if one of them writes a memory region that the other reads or writes. Only
+    /// such regions get a race checking assertion, so a pair without a conflict is
+    /// race free and does not have to be checked.
+    ///
+    /// The footprints are encoded as bitsets over the memory regions of the driver,
+    /// so each pair is checked with a few word operations.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="pair">Entry point pair</param>
+    public static bool HaveConflictingFootprints(EntryPointPair pair)
+    {
+      var session = AnalysisSession.Current;
+      var footprints = session.GetFootprints(() => SharedStateAnalyser.EncodeFootprints(session));
+
+      var reads1 = footprints[pair.EntryPoint1].Item1;
+      var writes1 = footprints[pair.EntryPoint1].Item2;
+      var reads2 = footprints[pair.EntryPoint2].Item1;
+      var writes2 = footprints[pair.EntryPoint2].Item2;
+
+      for (int i = 0; i < writes1.Length; i++)
+      {
+        if ((writes1[i] & (writes2[i] | reads2[i])) != 0 ||
+            (reads1[i] & writes2[i]) != 0)
+          return true;
+      }
+
+      return false;
+    }
+
     public static void AnalyseMemoryRegionsWithPairInformation(AnalysisContext ac, EntryPoint ep)
     {
       var memRegions = new List<Variable>();
@@ -132,24 +154,28 @@ namespace Whoop.Analysis
         }
       }
 
-      SharedStateAnalyser.EntryPointMemoryRegions[ep] = memRegions;
+      // The list is replaced instead of updated, as the entry points that pair
+      // with this one might be reading it concurrently
+      AnalysisSession.Current.EntryPointMemoryRegions[ep] = memRegions;
     }
 
     public static void AnalyseMemoryRegions(AnalysisContext ac, EntryPoint ep)
     {
-      if (SharedStateAnalyser.EntryPointMemoryRegions.ContainsKey(ep))
+      if (!AnalysisSession.Current.EntryPointMemoryRegions.TryAdd(ep, new List<Variable>()))
         return;
-      SharedStateAnalyser.EntryPointMemoryRegions.Add(ep, new List<Variable>());
+      AnalysisSession.Current.EntryPointReadRegions.TryAdd(ep, new HashSet<string>());
+      AnalysisSession.Current.EntryPointWriteRegions.TryAdd(ep, new HashSet<string>());
       SharedStateAnalyser.AnalyseMemoryRegions(ac, ep, ac.GetImplementation(ep.Name));
     }
 
     private static void AnalyseMemoryRegions(AnalysisContext ac, EntryPoint ep, Implementation impl)
     {
-      if (SharedStateAnalyser.AlreadyAnalyzedFunctions.Contains(impl))
+      if (!AnalysisSession.Current.AnalysedFunctions.TryAdd(impl, true))
         return;
-      SharedStateAnalyser.AlreadyAnalyzedFunctions.Add(impl);
 
       List<Variable> vars = new List<Variable>();
+      var reads = AnalysisSession.Current.EntryPointReadRegions[ep];
+      var writes = AnalysisSession.Current.EntryPointWriteRegions[ep];
 
       foreach (Block b in impl.Blocks)
       {
@@ -172,6 +198,7 @@ namespace Whoop.Analysis
 
               if (!vars.Any(val => val.Name.Equals(v.Name)))
                 vars.Add(v);
+              writes.Add(v.Name);
             }
 
             foreach (var lhs in (cmd as AssignCmd).Lhss.OfType<SimpleAssignLhs>())
@@ -184,6 +211,7 @@ namespace Whoop.Analysis
 
               if (!vars.Any(val => val.Name.Equals(v.Name)))
                 vars.Add(v);
+              writes.Add(v.Name);
             }
 
             foreach (var rhs in (cmd as AssignCmd).Rhss.OfType<NAryExpr>())
@@ -197,6 +225,7 @@ namespace Whoop.Analysis
 
               if (!vars.Any(val => val.Name.Equals(v.Name)))
                 vars.Add(v);
+              reads.Add(v.Name);
             }
 
             foreach (var rhs in (cmd as AssignCmd).Rhss.OfType<IdentifierExpr>())
@@ -209,6 +238,7 @@ namespace Whoop.Analysis
 
               if (!vars.Any(val => val.Name.Equals(v.Name)))
                 vars.Add(v);
+              reads.Add(v.Name);
             }
 
             SharedStateAnalyser.AnalyseMemoryRegionsInAssign(ac, ep, cmd as AssignCmd);
@@ -217,14 +247,60 @@ namespace Whoop.Analysis
       }
 
       vars = vars.OrderBy(val => val.Name).ToList();
-      SharedStateAnalyser.MemoryRegions.Add(impl, vars);
+      AnalysisSession.Current.MemoryRegions[impl] = vars;
 
+      var epVars = AnalysisSession.Current.EntryPointMemoryRegions[ep];
       foreach (var v in vars)
       {
-        if (SharedStateAnalyser.EntryPointMemoryRegions[ep].Any(val => val.Name.Equals(v.Name)))
+        if (epVars.Any(val => val.Name.Equals(v.Name)))
           continue;
-        SharedStateAnalyser.EntryPointMemoryRegions[ep].Add(v);
+        epVars.Add(v);
+      }
+    }
+
+    /// <summary>
+    /// Encodes the read and write footprints of all entry points of the given
+    /// session as bitsets. The session encodes them once, after all entry points
+    /// have been analysed.
+    /// </summary>
+    /// <returns>Map from entry points to read and write bitsets</returns>
+    /// <param name="session">Analysis session</param>
+    private static Dictionary<EntryPoint, Tuple<ulong[], ulong[]>> EncodeFootprints(AnalysisSession session)
+    {
+      var regions = new Dictionary<string, int>();
+      foreach (var name in session.EntryPointReadRegions.Values.Concat(
+        session.EntryPointWriteRegions.Values).SelectMany(val => val))
+      {
+        if (!regions.ContainsKey(name))
+          regions.Add(name, regions.Count);
+      }
+
+      int words = Math.Max(1, (regions.Count + 63) / 64);
+      var footprints = new Dictionary<EntryPoint, Tuple<ulong[], ulong[]>>();
+
+      foreach (var ep in DeviceDriver.EntryPoints)
+      {
+        footprints.Add(ep, new Tuple<ulong[], ulong[]>(
+          SharedStateAnalyser.Encode(session.EntryPointReadRegions, ep, regions, words),
+          SharedStateAnalyser.Encode(session.EntryPointWriteRegions, ep, regions, words)));
       }
+
+      return footprints;
+    }
+
+    private static ulong[] Encode(IDictionary<EntryPoint, HashSet<string>> footprints, EntryPoint ep,
+      Dictionary<string, int> regions, int words)
+    {
+      var bits = new ulong[words];
+
+      HashSet<string> names = null;
+      if (!footprints.TryGetValue(ep, out names))
+        return bits;
+
+      foreach (var name in names)
+        bits[regions[name] / 64] |= 1UL << (regions[name] % 64);
+
+      return bits;
     }
 
     private static void AnalyseMemoryRegionsInCall(AnalysisContext ac, EntryPoint ep, CallCmd cmd)
@@ -24,24 +24,12 @@ namespace Whoop
 {
   public class AnalysisContext : CheckingContext
   {
-    #region static fields
-
-    private static Dictionary<EntryPoint, AnalysisContext> Registry =
-      new Dictionary<EntryPoint, AnalysisContext>();
-
-    private static Dictionary<PairCheckingRegion, Tuple<EntryPoint, EntryPoint>> PairRegistry =
-      new Dictionary<PairCheckingRegion, Tuple<EntryPoint, EntryPoint>>();
-
-    internal static HashSet<Lock> GlobalLocks = new HashSet<Lock>();
-
-    #endregion
-
     #region fields
 
     public Program Program;
     public ResolutionContext ResContext;
 
-    public List<Declaration> TopLevelDeclarations;
+    public DeclarationList TopLevelDeclarations;
 
     internal List<InstrumentationRegion> InstrumentationRegions;
     internal List<Lock> Locks;
@@ -51,7 +39,7 @@ namespace Whoop
     internal Microsoft.Boogie.Type MemoryModelType;
 
     internal List<HashSet<string>> MatchedAccessesMap;
-    internal Dictionary<string, HashSet<Expr>> AxiomAccessesMap;
+    internal Dictionary<string, Dictionary<ExprKey, Expr>> AxiomAccessesMap;
 
     internal Constant DeviceStruct;
 
@@ -82,14 +70,13 @@ namespace Whoop
       this.MemoryModelType = Microsoft.Boogie.Type.Int;
 
       this.MatchedAccessesMap = new List<HashSet<string>>();
-      this.AxiomAccessesMap = new Dictionary<string, HashSet<Expr>>();
+      this.AxiomAccessesMap = new Dictionary<string, Dictionary<ExprKey, Expr>>();
 
       this.DeviceStruct = null;
 
       this.ResetToProgramTopLevelDeclarations();
 
-      this.Checker = this.TopLevelDeclarations.OfType<Implementation>().ToList().
-        FirstOrDefault(val => val.Name.Equals("whoop$checker"));
+      this.Checker = this.TopLevelDeclarations.FindByName<Implementation>("whoop$checker");
     }
 
     public void EliminateDeadVariables()
@@ -118,88 +105,82 @@ namespace Whoop
 
     public List<Implementation> GetCheckerImplementations()
     {
-      return this.TopLevelDeclarations.OfType<Implementation>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Implementation>("checker").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "checker"));
     }
 
     public List<Procedure> GetEntryPoints()
     {
-      return this.TopLevelDeclarations.OfType<Procedure>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Procedure>("entrypoint").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "entrypoint"));
     }
 
     public List<Procedure> GetEntryPointHelpers()
     {
-      return this.TopLevelDeclarations.OfType<Procedure>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Procedure>("tag").
         FindAll(val => QKeyValue.FindStringAttribute(val.Attributes, "tag") != null);
     }
 
     public List<Variable> GetLockVariables()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("lock").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "lock"));
     }
 
     public List<Variable> GetCurrentLocksetVariables()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("current_lockset").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "current_lockset"));
     }
 
     public List<Variable> GetMemoryLocksetVariables()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("lockset").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "lockset"));
     }
 
     public List<Variable> GetWriteAccessCheckingVariables()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("access_checking").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "access_checking") &&
           val.Name.Contains("WRITTEN_"));
     }
 
     public List<Variable> GetReadAccessCheckingVariables()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("access_checking").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "access_checking") &&
           val.Name.Contains("READ_"));
     }
 
     public List<Variable> GetDomainSpecificVariables()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("domain_specific").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "domain_specific"));
     }
 
     public List<Variable> GetAccessWatchdogConstants()
     {
-      return this.TopLevelDeclarations.OfType<Variable>().ToList().
+      return this.TopLevelDeclarations.FindByAttribute<Variable>("watchdog").
         FindAll(val => QKeyValue.FindBoolAttribute(val.Attributes, "watchdog"));
     }
 
     public Implementation GetImplementation(string name)
     {
       Contract.Requires(name != null);
-      var impl = (this.TopLevelDeclarations.FirstOrDefault(val => (val is Implementation) &&
-        (val as Implementation).Name.Equals(name)) as Implementation);
-      return impl;
+      return this.TopLevelDeclarations.FindByName<Implementation>(name);
     }
 
     public Constant GetConstant(string name)
     {
       Contract.Requires(name != null);
-      var cons = (this.TopLevelDeclarations.FirstOrDefault(val => (val is Constant) &&
-        (val as Constant).Name.Equals(name)) as Constant);
-      return cons;
+      return this.TopLevelDeclarations.FindByName<Constant>(name);
     }
 
     public Axiom GetAxiom(string name)
     {
       Contract.Requires(name != null);
-      var axiom = (this.TopLevelDeclarations.FirstOrDefault(val => (val is Axiom) &&
-        (val as Axiom).Expr.ToString().Equals("$isExternal(" + name + ")")) as Axiom);
-      return axiom;
+      return this.TopLevelDeclarations.FindAxiom("$isExternal(" + name + ")");
     }
 
     public bool IsAWhoopVariable(Variable v)
@@ -296,12 +277,24 @@ namespace Whoop
       this.Locks.Clear();
       this.CurrentLocksets.Clear();
       this.MemoryLocksets.Clear();
-      this.TopLevelDeclarations = this.Program.TopLevelDeclarations.ToArray().ToList();
+      this.TopLevelDeclarations = new DeclarationList(this.Program.TopLevelDeclarations);
     }
 
     public void ResetToProgramTopLevelDeclarations()
     {
-      this.TopLevelDeclarations = this.Program.TopLevelDeclarations.ToArray().ToList();
+      this.TopLevelDeclarations = new DeclarationList(this.Program.TopLevelDeclarations);
+    }
+
+    /// <summary>
+    /// Creates a fresh analysis context over the same program. The view has its own
+    /// top level declaration list, locks, locksets and resolution context, so passes
+    /// on different views can run concurrently. The declarations themselves are
+    /// shared between views, so passes must replace them instead of changing them.
+    /// </summary>
+    /// <returns>Analysis context</returns>
+    public AnalysisContext CreateView()
+    {
+      return new AnalysisContext(this.Program, new ResolutionContext(null));
     }
 
     #endregion
@@ -310,42 +303,32 @@ namespace Whoop
 
     public static AnalysisContext GetAnalysisContext(EntryPoint ep)
     {
-      if (!AnalysisContext.Registry.ContainsKey(ep))
-        return null;
-      return AnalysisContext.Registry[ep];
+      AnalysisContext ac = null;
+      AnalysisSession.Current.Registry.TryGetValue(ep, out ac);
+      return ac;
     }
 
     public static void RegisterEntryPointAnalysisContext(AnalysisContext ac, EntryPoint ep)
     {
-      if (AnalysisContext.Registry.ContainsKey(ep))
-        AnalysisContext.Registry[ep] = ac;
-      else
-        AnalysisContext.Registry.Add(ep, ac);
+      AnalysisSession.Current.Registry[ep] = ac;
     }
 
     internal static PairCheckingRegion GetPairAnalysisContext(EntryPoint ep1, EntryPoint ep2)
     {
-      if (AnalysisContext.PairRegistry.Any(val =>
-        (val.Value.Item1.Equals(ep1) && val.Value.Item2.Equals(ep2)) ||
-        (val.Value.Item1.Equals(ep2) && val.Value.Item2.Equals(ep1))))
+      foreach (var val in AnalysisSession.Current.PairRegistry)
       {
-        return AnalysisContext.PairRegistry.First(val =>
-          (val.Value.Item1.Equals(ep1) && val.Value.Item2.Equals(ep2)) ||
-        (val.Value.Item1.Equals(ep2) && val.Value.Item2.Equals(ep1))).Key;
-      }
-      else
-      {
-        return null;
+        if ((val.Value.Item1.Equals(ep1) && val.Value.Item2.Equals(ep2)) ||
+          (val.Value.Item1.Equals(ep2) && val.Value.Item2.Equals(ep1)))
+          return val.Key;
       }
+
+      return null;
     }
 
     internal static void RegisterPairEntryPointAnalysisContext(PairCheckingRegion region,
       EntryPoint ep1, EntryPoint ep2)
     {
-      if (AnalysisContext.PairRegistry.ContainsKey(region))
-        AnalysisContext.PairRegistry[region] = new Tuple<EntryPoint, EntryPoint>(ep1, ep2);
-      else
-        AnalysisContext.PairRegistry.Add(region, new Tuple<EntryPoint, EntryPoint>(ep1, ep2));
+      AnalysisSession.Current.PairRegistry[region] = new Tuple<EntryPoint, EntryPoint>(ep1, ep2);
     }
 
     #endregion
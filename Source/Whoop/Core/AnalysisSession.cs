@@ -0,0 +1,179 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.Linq;
+using Microsoft.Boogie;
+
+using Whoop.Analysis;
+using Whoop.Domain.Drivers;
+using Whoop.Regions;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Holds the state that the analyses of a single run share across entry points,
+  /// such as the registered analysis contexts, the global locks, the memory regions
+  /// and the def-use indexes. All of it is safe to use from the concurrently running
+  /// per entry point passes, as long as each entry point is handled by one task.
+  /// </summary>
+  public sealed class AnalysisSession
+  {
+    #region fields
+
+    private static AnalysisSession CurrentSession = new AnalysisSession();
+
+    internal readonly ConcurrentDictionary<EntryPoint, AnalysisContext> Registry;
+    internal readonly ConcurrentDictionary<PairCheckingRegion, Tuple<EntryPoint, EntryPoint>> PairRegistry;
+
+    private readonly HashSet<Lock> GlobalLocks;
+
+    internal readonly ConcurrentDictionary<Implementation, bool> AnalysedFunctions;
+    internal readonly ConcurrentDictionary<EntryPoint, List<Variable>> EntryPointMemoryRegions;
+    internal readonly ConcurrentDictionary<Implementation, List<Variable>> MemoryRegions;
+    internal readonly ConcurrentDictionary<EntryPoint, HashSet<string>> EntryPointReadRegions;
+    internal readonly ConcurrentDictionary<EntryPoint, HashSet<string>> EntryPointWriteRegions;
+
+    internal readonly ConcurrentDictionary<EntryPoint, ConcurrentDictionary<Implementation, DefUseIndex>> Indexes;
+
+    private readonly ConcurrentDictionary<string, bool> ParsedEntryPoints;
+
+    private Dictionary<EntryPoint, Tuple<ulong[], ulong[]>> Footprints;
+    private readonly object FootprintLock;
+
+    /// <summary>
+    /// The session of the current run.
+    /// </summary>
+    public static AnalysisSession Current
+    {
+      get { return AnalysisSession.CurrentSession; }
+    }
+
+    #endregion
+
+    #region public API
+
+    private AnalysisSession()
+    {
+      this.Registry = new ConcurrentDictionary<EntryPoint, AnalysisContext>();
+      this.PairRegistry = new ConcurrentDictionary<PairCheckingRegion, Tuple<EntryPoint, EntryPoint>>();
+      this.GlobalLocks = new HashSet<Lock>();
+
+      this.AnalysedFunctions = new ConcurrentDictionary<Implementation, bool>();
+      this.EntryPointMemoryRegions = new ConcurrentDictionary<EntryPoint, List<Variable>>();
+      this.MemoryRegions = new ConcurrentDictionary<Implementation, List<Variable>>();
+      this.EntryPointReadRegions = new ConcurrentDictionary<EntryPoint, HashSet<string>>();
+      this.EntryPointWriteRegions = new ConcurrentDictionary<EntryPoint, HashSet<string>>();
+
+      this.Indexes = new ConcurrentDictionary<EntryPoint, ConcurrentDictionary<Implementation, DefUseIndex>>();
+      this.ParsedEntryPoints = new ConcurrentDictionary<string, bool>();
+
+      this.Footprints = null;
+      this.FootprintLock = new object();
+    }
+
+    /// <summary>
+    /// Starts a new run, dropping everything that the previous run left behind.
+    /// </summary>
+    public static void Start()
+    {
+      AnalysisSession.CurrentSession = new AnalysisSession();
+    }
+
+    /// <summary>
+    /// Checks if the entry point with the given name has already been parsed.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="name">Entry point name</param>
+    public bool IsParsed(string name)
+    {
+      Contract.Requires(name != null);
+      return this.ParsedEntryPoints.ContainsKey(name);
+    }
+
+    /// <summary>
+    /// Records that the entry point with the given name has been parsed.
+    /// </summary>
+    /// <param name="name">Entry point name</param>
+    public void MarkAsParsed(string name)
+    {
+      Contract.Requires(name != null);
+      this.ParsedEntryPoints[name] = true;
+    }
+
+    #endregion
+
+    #region internal API
+
+    /// <summary>
+    /// Records a lock that is visible to all entry points.
+    /// </summary>
+    /// <param name="l">Lock</param>
+    internal void AddGlobalLock(Lock l)
+    {
+      Contract.Requires(l != null);
+      lock (this.GlobalLocks)
+      {
+        this.GlobalLocks.Add(l);
+      }
+    }
+
+    /// <summary>
+    /// Returns a snapshot of the locks that are visible to all entry points.
+    /// </summary>
+    /// <returns>Global locks</returns>
+    internal List<Lock> GetGlobalLocks()
+    {
+      lock (this.GlobalLocks)
+      {
+        return this.GlobalLocks.ToList();
+      }
+    }
+
+    /// <summary>
+    /// Returns the def-use index of the given implementation of the given entry
+    /// point, creating it if necessary.
+    /// </summary>
+    /// <returns>Def-use index</returns>
+    /// <param name="ep">Entry point</param>
+    /// <param name="impl">Implementation</param>
+    internal DefUseIndex GetDefUseIndex(EntryPoint ep, Implementation impl)
+    {
+      Contract.Requires(ep != null && impl != null);
+      var indexes = this.Indexes.GetOrAdd(ep, val =>
+        new ConcurrentDictionary<Implementation, DefUseIndex>());
+      return indexes.GetOrAdd(impl, val => new DefUseIndex(val));
+    }
+
+    /// <summary>
+    /// Returns the read and write footprints of the entry points, encoding them
+    /// with the given function the first time they are requested.
+    /// </summary>
+    /// <returns>Map from entry points to read and write bitsets</returns>
+    /// <param name="encode">Encodes the footprints</param>
+    internal Dictionary<EntryPoint, Tuple<ulong[], ulong[]>> GetFootprints(
+      Func<Dictionary<EntryPoint, Tuple<ulong[], ulong[]>>> encode)
+    {
+      Contract.Requires(encode != null);
+      lock (this.FootprintLock)
+      {
+        if (this.Footprints == null)
+          this.Footprints = encode();
+        return this.Footprints;
+      }
+    }
+
+    #endregion
+  }
+}
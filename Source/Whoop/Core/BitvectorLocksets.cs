@@ -0,0 +1,191 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.Linq;
+
+using Microsoft.Boogie;
+using Microsoft.Basetypes;
+
+namespace Whoop
+{
+  /// <summary>
+  /// The bitvector encoding of locksets, which is used instead of one boolean per
+  /// lock when /bitvectorLocksets is given. Each lockset is a single bitvector with
+  /// one bit per lock, so acquiring or releasing a lock, updating the lockset of a
+  /// memory region and intersecting two locksets are one bitvector operation each,
+  /// however many locks the driver uses.
+  ///
+  /// The bits are assigned to the locks in the order of their names, so all analysis
+  /// contexts of a driver agree on them.
+  /// </summary>
+  internal static class BitvectorLocksets
+  {
+    #region public API
+
+    /// <summary>
+    /// Returns the locks of the given analysis context in the order of their bits.
+    /// </summary>
+    /// <returns>Lock variables</returns>
+    /// <param name="ac">Analysis context</param>
+    public static List<Variable> GetLocks(AnalysisContext ac)
+    {
+      Contract.Requires(ac != null);
+      return ac.GetLockVariables().OrderBy(val => val.Name, StringComparer.Ordinal).ToList();
+    }
+
+    /// <summary>
+    /// Declares the bitvector operations on locksets of the given width, unless they
+    /// have already been declared.
+    /// </summary>
+    /// <param name="ac">Analysis context</param>
+    /// <param name="width">Width of the locksets</param>
+    public static void AddFunctions(AnalysisContext ac, int width)
+    {
+      Contract.Requires(ac != null && width > 0);
+      BitvectorLocksets.AddFunction(ac, "AND", "bvand", width, 2);
+      BitvectorLocksets.AddFunction(ac, "OR", "bvor", width, 2);
+      BitvectorLocksets.AddFunction(ac, "NOT", "bvnot", width, 1);
+    }
+
+    public static Expr And(AnalysisContext ac, int width, Expr lhs, Expr rhs)
+    {
+      return BitvectorLocksets.Apply(ac, "AND", width, lhs, rhs);
+    }
+
+    public static Expr Or(AnalysisContext ac, int width, Expr lhs, Expr rhs)
+    {
+      return BitvectorLocksets.Apply(ac, "OR", width, lhs, rhs);
+    }
+
+    public static Expr Not(AnalysisContext ac, int width, Expr expr)
+    {
+      return BitvectorLocksets.Apply(ac, "NOT", width, expr);
+    }
+
+    /// <summary>
+    /// Returns the width of the given lockset variable.
+    /// </summary>
+    /// <returns>Width</returns>
+    /// <param name="v">Lockset variable</param>
+    public static int GetWidth(Variable v)
+    {
+      return v.TypedIdent.Type.BvBits;
+    }
+
+    /// <summary>
+    /// Creates a bitvector literal that has the given bits set.
+    /// </summary>
+    /// <returns>Literal</returns>
+    /// <param name="width">Width of the locksets</param>
+    /// <param name="bits">Bits</param>
+    public static LiteralExpr CreateMask(int width, IEnumerable<int> bits)
+    {
+      var value = BigNum.ZERO;
+      foreach (var bit in bits.Distinct())
+      {
+        var pow = BigNum.ONE;
+        for (int i = 0; i < bit; i++)
+          pow = pow * BigNum.FromInt(2);
+        value = value + pow;
+      }
+
+      return new LiteralExpr(Token.NoToken, value, width);
+    }
+
+    /// <summary>
+    /// Creates an expression that holds if the lock of the given lockset is in the
+    /// lockset.
+    /// </summary>
+    /// <returns>Expression</returns>
+    /// <param name="ls">Lockset</param>
+    public static Expr CreateBitExpr(Lockset ls)
+    {
+      Contract.Requires(ls != null && ls.Bit >= 0);
+      return Expr.Eq(new BvExtractExpr(Token.NoToken, new IdentifierExpr(ls.Id.tok, ls.Id),
+        ls.Bit + 1, ls.Bit), new LiteralExpr(Token.NoToken, BigNum.ONE, 1));
+    }
+
+    /// <summary>
+    /// Creates an expression that holds if the given bits of the lockset are all set,
+    /// or all clear.
+    /// </summary>
+    /// <returns>Expression</returns>
+    /// <param name="ac">Analysis context</param>
+    /// <param name="v">Lockset variable</param>
+    /// <param name="bits">Bits</param>
+    /// <param name="value">Value of the bits</param>
+    public static Expr CreateMaskedEq(AnalysisContext ac, Variable v, List<int> bits, bool value)
+    {
+      int width = BitvectorLocksets.GetWidth(v);
+      var mask = BitvectorLocksets.CreateMask(width, bits);
+      var rhs = value ? mask : BitvectorLocksets.CreateMask(width, new List<int>());
+
+      if (bits.Distinct().Count() == width)
+        return Expr.Eq(new IdentifierExpr(v.tok, v), rhs);
+      return Expr.Eq(BitvectorLocksets.And(ac, width, new IdentifierExpr(v.tok, v), mask), rhs);
+    }
+
+    /// <summary>
+    /// Creates an expression that holds if the given bits of the lockset still have
+    /// the value that they had on entry to the procedure.
+    /// </summary>
+    /// <returns>Expression</returns>
+    /// <param name="ac">Analysis context</param>
+    /// <param name="v">Lockset variable</param>
+    /// <param name="bits">Bits</param>
+    public static Expr CreateFrameExpr(AnalysisContext ac, Variable v, List<int> bits)
+    {
+      int width = BitvectorLocksets.GetWidth(v);
+      var mask = BitvectorLocksets.CreateMask(width, bits);
+      return Expr.Eq(BitvectorLocksets.And(ac, width, new IdentifierExpr(v.tok, v), mask),
+        BitvectorLocksets.And(ac, width, new OldExpr(Token.NoToken,
+          new IdentifierExpr(v.tok, v)), mask));
+    }
+
+    #endregion
+
+    #region other methods
+
+    private static string GetFunctionName(string op, int width)
+    {
+      return "_LS_" + op + "_$bv" + width;
+    }
+
+    private static void AddFunction(AnalysisContext ac, string op, string builtin, int width, int arity)
+    {
+      string name = BitvectorLocksets.GetFunctionName(op, width);
+      if (ac.TopLevelDeclarations.FindByName<Function>(name) != null)
+        return;
+
+      var type = new BvType(width);
+      var args = new List<Variable>();
+      for (int i = 0; i < arity; i++)
+        args.Add(new Formal(Token.NoToken, new TypedIdent(Token.NoToken, "ls" + i, type), true));
+      var result = new Formal(Token.NoToken, new TypedIdent(Token.NoToken, "r", type), false);
+
+      var func = new Function(Token.NoToken, name, args, result);
+      func.AddAttribute("bvbuiltin", new object[] { builtin });
+      ac.TopLevelDeclarations.Add(func);
+    }
+
+    private static Expr Apply(AnalysisContext ac, string op, int width, params Expr[] args)
+    {
+      var func = ac.TopLevelDeclarations.FindByName<Function>(
+        BitvectorLocksets.GetFunctionName(op, width));
+      return new NAryExpr(Token.NoToken, new FunctionCall(func), args.ToList());
+    }
+
+    #endregion
+  }
+}
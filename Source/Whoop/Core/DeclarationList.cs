@@ -0,0 +1,223 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Collections.ObjectModel;
+using System.Diagnostics.Contracts;
+using System.Linq;
+using Microsoft.Boogie;
+
+namespace Whoop
+{
+  /// <summary>
+  /// List of top level declarations that keeps a name index up to date as
+  /// declarations are added and removed. Attributes are not indexed, as passes
+  /// add them in place to declarations that are already in the list.
+  /// </summary>
+  public sealed class DeclarationList : Collection<Declaration>
+  {
+    #region fields
+
+    private Dictionary<string, List<NamedDeclaration>> NameIndex;
+    private Dictionary<string, List<Axiom>> AxiomIndex;
+    private bool IsIndexValid;
+
+    #endregion
+
+    #region public API
+
+    public DeclarationList(IEnumerable<Declaration> declarations)
+      : base(new List<Declaration>(declarations))
+    {
+      Contract.Requires(declarations != null);
+      this.NameIndex = new Dictionary<string, List<NamedDeclaration>>();
+      this.AxiomIndex = new Dictionary<string, List<Axiom>>();
+      this.IsIndexValid = false;
+    }
+
+    /// <summary>
+    /// Removes all declarations that match the given predicate.
+    /// </summary>
+    /// <returns>Number of removed declarations</returns>
+    /// <param name="match">Predicate</param>
+    public int RemoveAll(Predicate<Declaration> match)
+    {
+      Contract.Requires(match != null);
+      int count = (this.Items as List<Declaration>).RemoveAll(match);
+      if (count > 0)
+        this.IsIndexValid = false;
+      return count;
+    }
+
+    /// <summary>
+    /// Marks the index as stale. Passes that rename declarations that are already
+    /// in the list must call this, as the index is only updated when declarations
+    /// are added or removed.
+    /// </summary>
+    public void InvalidateIndex()
+    {
+      this.IsIndexValid = false;
+    }
+
+    /// <summary>
+    /// Returns the first declaration of the given type with the given name.
+    /// </summary>
+    /// <returns>Declaration</returns>
+    /// <param name="name">Name</param>
+    public T FindByName<T>(string name) where T : NamedDeclaration
+    {
+      Contract.Requires(name != null);
+      this.EnsureIndex();
+
+      List<NamedDeclaration> decls = null;
+      if (this.NameIndex.TryGetValue(name, out decls))
+      {
+        foreach (var decl in decls)
+        {
+          if (decl is T && decl.Name.Equals(name))
+            return decl as T;
+        }
+      }
+
+      return null;
+    }
+
+    /// <summary>
+    /// Returns the declarations of the given type that carry the given attribute.
+    /// </summary>
+    /// <returns>Declarations</returns>
+    /// <param name="attribute">Attribute</param>
+    public List<T> FindByAttribute<T>(string attribute) where T : Declaration
+    {
+      Contract.Requires(attribute != null);
+      return this.Items.OfType<T>().Where(val => DeclarationList.HasAttribute(val, attribute)).ToList();
+    }
+
+    /// <summary>
+    /// Returns the first axiom whose expression prints as the given string.
+    /// </summary>
+    /// <returns>Axiom</returns>
+    /// <param name="expr">Expression string</param>
+    public Axiom FindAxiom(string expr)
+    {
+      Contract.Requires(expr != null);
+      this.EnsureIndex();
+
+      List<Axiom> axioms = null;
+      if (this.AxiomIndex.TryGetValue(expr, out axioms))
+      {
+        foreach (var axiom in axioms)
+        {
+          if (axiom.Expr.ToString().Equals(expr))
+            return axiom;
+        }
+      }
+
+      return null;
+    }
+
+    #endregion
+
+    #region index maintenance
+
+    protected override void InsertItem(int index, Declaration item)
+    {
+      base.InsertItem(index, item);
+      if (!this.IsIndexValid)
+        return;
+      if (index == this.Count - 1)
+        this.AddToIndex(item);
+      else
+        this.IsIndexValid = false;
+    }
+
+    protected override void RemoveItem(int index)
+    {
+      var item = this[index];
+      base.RemoveItem(index);
+      if (this.IsIndexValid)
+        this.RemoveFromIndex(item);
+    }
+
+    protected override void SetItem(int index, Declaration item)
+    {
+      base.SetItem(index, item);
+      this.IsIndexValid = false;
+    }
+
+    protected override void ClearItems()
+    {
+      base.ClearItems();
+      this.IsIndexValid = false;
+    }
+
+    private void EnsureIndex()
+    {
+      if (this.IsIndexValid)
+        return;
+
+      this.NameIndex.Clear();
+      this.AxiomIndex.Clear();
+      foreach (var decl in this.Items)
+        this.AddToIndex(decl);
+
+      this.IsIndexValid = true;
+    }
+
+    private void AddToIndex(Declaration decl)
+    {
+      if (decl is NamedDeclaration)
+      {
+        var name = (decl as NamedDeclaration).Name;
+        if (!this.NameIndex.ContainsKey(name))
+          this.NameIndex.Add(name, new List<NamedDeclaration>());
+        this.NameIndex[name].Add(decl as NamedDeclaration);
+      }
+      else if (decl is Axiom)
+      {
+        var expr = (decl as Axiom).Expr.ToString();
+        if (!this.AxiomIndex.ContainsKey(expr))
+          this.AxiomIndex.Add(expr, new List<Axiom>());
+        this.AxiomIndex[expr].Add(decl as Axiom);
+      }
+    }
+
+    private void RemoveFromIndex(Declaration decl)
+    {
+      if (decl is NamedDeclaration)
+      {
+        List<NamedDeclaration> decls = null;
+        if (this.NameIndex.TryGetValue((decl as NamedDeclaration).Name, out decls))
+          decls.Remove(decl as NamedDeclaration);
+      }
+      else if (decl is Axiom)
+      {
+        List<Axiom> axioms = null;
+        if (this.AxiomIndex.TryGetValue((decl as Axiom).Expr.ToString(), out axioms))
+          axioms.Remove(decl as Axiom);
+      }
+    }
+
+    private static bool HasAttribute(Declaration decl, string attribute)
+    {
+      for (var kv = decl.Attributes; kv != null; kv = kv.Next)
+      {
+        if (kv.Key.Equals(attribute))
+          return true;
+      }
+
+      return false;
+    }
+
+    #endregion
+  }
+}
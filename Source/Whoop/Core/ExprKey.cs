@@ -0,0 +1,153 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using Microsoft.Boogie;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Structural key of an expression. Two expressions get equal keys if they have
+  /// the same shape, identifier names, literal values and function names, which
+  /// makes keys usable for deduplicating accesses such as $pa(p, i, s) or p + k
+  /// without printing them. The hash of a key is computed once, from the hashes
+  /// of its children.
+  /// </summary>
+  internal sealed class ExprKey
+  {
+    #region fields
+
+    private enum KeyKind
+    {
+      Identifier = 0,
+      Literal,
+      Application,
+      Other
+    }
+
+    private readonly KeyKind Kind;
+    private readonly string Label;
+    private readonly ExprKey[] Children;
+    private readonly int Hash;
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// Returns the key of the given expression. The key is computed from scratch
+    /// on every call, as passes rename identifiers in place.
+    /// </summary>
+    /// <returns>Key</returns>
+    /// <param name="expr">Expression</param>
+    public static ExprKey Of(Expr expr)
+    {
+      Contract.Requires(expr != null);
+
+      if (expr is IdentifierExpr)
+      {
+        return new ExprKey(KeyKind.Identifier, (expr as IdentifierExpr).Name, null);
+      }
+      else if (expr is LiteralExpr)
+      {
+        return new ExprKey(KeyKind.Literal, (expr as LiteralExpr).Val.ToString(), null);
+      }
+      else if (expr is NAryExpr)
+      {
+        var nary = expr as NAryExpr;
+        var children = new ExprKey[nary.Args.Count];
+        for (int idx = 0; idx < nary.Args.Count; idx++)
+          children[idx] = ExprKey.Of(nary.Args[idx]);
+        return new ExprKey(KeyKind.Application, nary.Fun.FunctionName, children);
+      }
+
+      return new ExprKey(KeyKind.Other, expr.ToString(), null);
+    }
+
+    /// <summary>
+    /// Checks if the key is an application of the given function whose first
+    /// argument has the given key.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="function">Function name</param>
+    /// <param name="arg">Key of the first argument</param>
+    public bool IsApplicationOf(string function, ExprKey arg)
+    {
+      return this.Kind == KeyKind.Application && this.Children.Length > 0 &&
+        this.Label.Equals(function) && this.Children[0].Equals(arg);
+    }
+
+    public override bool Equals(object obj)
+    {
+      if (Object.ReferenceEquals(this, obj))
+        return true;
+
+      var other = obj as ExprKey;
+      if (Object.ReferenceEquals(other, null) || other.Hash != this.Hash || other.Kind != this.Kind ||
+          !other.Label.Equals(this.Label))
+        return false;
+
+      if (this.Children == null || other.Children == null)
+        return this.Children == other.Children;
+      if (this.Children.Length != other.Children.Length)
+        return false;
+
+      for (int idx = 0; idx < this.Children.Length; idx++)
+      {
+        if (!this.Children[idx].Equals(other.Children[idx]))
+          return false;
+      }
+
+      return true;
+    }
+
+    public override int GetHashCode()
+    {
+      return this.Hash;
+    }
+
+    public static bool operator ==(ExprKey key1, ExprKey key2)
+    {
+      if (Object.ReferenceEquals(key1, null))
+        return Object.ReferenceEquals(key2, null);
+      return key1.Equals(key2);
+    }
+
+    public static bool operator !=(ExprKey key1, ExprKey key2)
+    {
+      return !(key1 == key2);
+    }
+
+    #endregion
+
+    #region helper functions
+
+    private ExprKey(KeyKind kind, string label, ExprKey[] children)
+    {
+      this.Kind = kind;
+      this.Label = label;
+      this.Children = children;
+
+      int hash = ((int)kind * 31) ^ label.GetHashCode();
+      if (children != null)
+      {
+        foreach (var child in children)
+          hash = (hash * 31) ^ child.Hash;
+      }
+
+      this.Hash = hash;
+    }
+
+    #endregion
+  }
+}
@@ -10,6 +10,7 @@
 // ===----------------------------------------------------------------------===//
 
 using System;
+using System.Collections;
 using System.Collections.Generic;
 using Microsoft.Boogie;
 using Whoop.Regions;
@@ -20,117 +21,234 @@ namespace Whoop
   {
     #region fields
 
-    private Dictionary<Node, HashSet<Node>> PredCache;
-    private Dictionary<Node, HashSet<Node>> SuccCache;
+    private Dictionary<Node, HashSet<Node>> PredMap;
+    private Dictionary<Node, HashSet<Node>> SuccMap;
 
-    private bool IsComputed;
-
-    internal HashSet<Tuple<Node, Node>> Edges;
     internal HashSet<Node> Nodes;
 
+    /// <summary>
+    /// Memoises the transitive successors and predecessors of the strongly
+    /// connected components of the graph. Any mutation invalidates it.
+    /// </summary>
+    private bool MemoiseReachability;
+    private bool IsReachabilityComputed;
+
+    private Dictionary<Node, int> ComponentOf;
+    private List<List<Node>> Components;
+    private List<bool> IsCyclicComponent;
+    private List<BitArray> ReachableComponents;
+    private List<BitArray> ReachingComponents;
+
     #endregion
 
     #region public API
 
-    public Graph()
+    public Graph(bool memoiseReachability = false)
     {
-      this.Edges = new HashSet<Tuple<Node, Node>>();
+      this.PredMap = new Dictionary<Node, HashSet<Node>>();
+      this.SuccMap = new Dictionary<Node, HashSet<Node>>();
       this.Nodes = new HashSet<Node>();
 
-      this.PredCache = new Dictionary<Node, HashSet<Node>>();
-      this.SuccCache = new Dictionary<Node, HashSet<Node>>();
-      this.IsComputed = false;
+      this.MemoiseReachability = memoiseReachability;
+      this.IsReachabilityComputed = false;
     }
 
     public void AddEdge(Node source, Node dest)
     {
-      this.Edges.Add(new Tuple<Node, Node>(source, dest));
-      this.Nodes.Add(source);
-      this.Nodes.Add(dest);
-      this.IsComputed = false;
+      this.AddNode(source);
+      this.AddNode(dest);
+
+      if (this.SuccMap[source].Add(dest))
+      {
+        this.PredMap[dest].Add(source);
+        this.IsReachabilityComputed = false;
+      }
     }
 
+    /// <summary>
+    /// Returns the direct predecessors of the given node. The returned set is a
+    /// copy, so callers are free to modify it.
+    /// </summary>
+    /// <returns>Predecessors</returns>
+    /// <param name="node">Node</param>
     public HashSet<Node> Predecessors(Node node)
     {
-      ComputePredSuccCaches();
-      if (!this.PredCache.ContainsKey(node))
+      if (!this.PredMap.ContainsKey(node))
         return new HashSet<Node>();
-      return this.PredCache[node];
+      return new HashSet<Node>(this.PredMap[node]);
     }
 
+    /// <summary>
+    /// Returns the direct successors of the given node. The returned set is a
+    /// copy, so callers are free to modify it.
+    /// </summary>
+    /// <returns>Successors</returns>
+    /// <param name="node">Node</param>
     public HashSet<Node> Successors(Node node)
     {
-      ComputePredSuccCaches();
-      if (!this.SuccCache.ContainsKey(node))
+      if (!this.SuccMap.ContainsKey(node))
         return new HashSet<Node>();
-      return this.SuccCache[node];
+      return new HashSet<Node>(this.SuccMap[node]);
     }
 
     public HashSet<Node> NestedPredecessors(Node node)
     {
-      ComputePredSuccCaches();
-      if (!this.PredCache.ContainsKey(node))
+      if (!this.PredMap.ContainsKey(node))
         return new HashSet<Node>();
-
-      var nestedPred = new HashSet<Node>();
-      this.ComputeNestedPredecessors(node, nestedPred);
-
-      return nestedPred;
+      if (this.MemoiseReachability)
+        return this.GetMemoisedNodes(node, false);
+      return this.ComputeNested(node, this.PredMap, default(Node), false);
     }
 
+    /// <summary>
+    /// Returns the transitive predecessors of the given node. The skip node is
+    /// included, but its own predecessors are not followed when it is a direct
+    /// predecessor of the given node.
+    /// </summary>
+    /// <returns>Predecessors</returns>
+    /// <param name="node">Node</param>
+    /// <param name="skipNode">Node to skip</param>
     public HashSet<Node> NestedPredecessors(Node node, Node skipNode)
     {
-      ComputePredSuccCaches();
-      if (!this.PredCache.ContainsKey(node))
+      if (!this.PredMap.ContainsKey(node))
         return new HashSet<Node>();
-
-      var nestedPred = new HashSet<Node>();
-      this.ComputeNestedPredecessors(node, nestedPred, skipNode);
-
-      return nestedPred;
+      return this.ComputeNested(node, this.PredMap, skipNode, true);
     }
 
     public HashSet<Node> NestedSuccessors(Node node)
     {
-      ComputePredSuccCaches();
-      if (!this.SuccCache.ContainsKey(node))
+      if (!this.SuccMap.ContainsKey(node))
         return new HashSet<Node>();
-
-      var nestedSucc = new HashSet<Node>();
-      this.ComputeNestedSuccessors(node, nestedSucc);
-
-      return nestedSucc;
+      if (this.MemoiseReachability)
+        return this.GetMemoisedNodes(node, true);
+      return this.ComputeNested(node, this.SuccMap, default(Node), false);
     }
 
+    /// <summary>
+    /// Returns the transitive successors of the given node. The skip node is
+    /// included, but its own successors are not followed when it is a direct
+    /// successor of the given node.
+    /// </summary>
+    /// <returns>Successors</returns>
+    /// <param name="node">Node</param>
+    /// <param name="skipNode">Node to skip</param>
     public HashSet<Node> NestedSuccessors(Node node, Node skipNode)
     {
-      ComputePredSuccCaches();
-      if (!this.SuccCache.ContainsKey(node))
+      if (!this.SuccMap.ContainsKey(node))
         return new HashSet<Node>();
+      return this.ComputeNested(node, this.SuccMap, skipNode, true);
+    }
+
+    /// <summary>
+    /// Computes the strongly connected components of the graph. Components are
+    /// returned in reverse topological order, so each component comes after all
+    /// components that it has edges to.
+    /// </summary>
+    /// <returns>Strongly connected components</returns>
+    public List<HashSet<Node>> ComputeStronglyConnectedComponents()
+    {
+      var components = new List<HashSet<Node>>();
+      var index = new Dictionary<Node, int>();
+      var lowLink = new Dictionary<Node, int>();
+      var stack = new Stack<Node>();
+      var onStack = new HashSet<Node>();
+      int counter = 0;
+
+      // Iterative version of Tarjan's algorithm, to avoid deep recursion.
+      foreach (var root in this.Nodes)
+      {
+        if (index.ContainsKey(root))
+          continue;
 
-      var nestedSucc = new HashSet<Node>();
-      this.ComputeNestedSuccessors(node, nestedSucc, skipNode);
+        var work = new Stack<Tuple<Node, IEnumerator<Node>>>();
+        index.Add(root, counter);
+        lowLink.Add(root, counter);
+        counter++;
+        stack.Push(root);
+        onStack.Add(root);
+        work.Push(new Tuple<Node, IEnumerator<Node>>(root, this.SuccMap[root].GetEnumerator()));
 
-      return nestedSucc;
+        while (work.Count > 0)
+        {
+          var node = work.Peek().Item1;
+          var successors = work.Peek().Item2;
+
+          if (successors.MoveNext())
+          {
+            var succ = successors.Current;
+            if (!index.ContainsKey(succ))
+            {
+              index.Add(succ, counter);
+              lowLink.Add(succ, counter);
+              counter++;
+              stack.Push(succ);
+              onStack.Add(succ);
+              work.Push(new Tuple<Node, IEnumerator<Node>>(succ, this.SuccMap[succ].GetEnumerator()));
+            }
+            else if (onStack.Contains(succ))
+            {
+              lowLink[node] = Math.Min(lowLink[node], index[succ]);
+            }
+
+            continue;
+          }
+
+          work.Pop();
+          if (work.Count > 0)
+          {
+            var parent = work.Peek().Item1;
+            lowLink[parent] = Math.Min(lowLink[parent], lowLink[node]);
+          }
+
+          if (lowLink[node] != index[node])
+            continue;
+
+          var component = new HashSet<Node>();
+          Node member;
+          do
+          {
+            member = stack.Pop();
+            onStack.Remove(member);
+            component.Add(member);
+          }
+          while (!member.Equals(node));
+
+          components.Add(component);
+        }
+      }
+
+      return components;
     }
 
     public void Remove(Node node)
     {
-      if (node == null)
+      if (node == null || !this.Nodes.Contains(node))
         return;
 
-      this.Edges.RemoveWhere(val => val.Item1.Equals(node) || val.Item2.Equals(node));
+      foreach (var succ in this.SuccMap[node])
+      {
+        if (!succ.Equals(node))
+          this.PredMap[succ].Remove(node);
+      }
+
+      foreach (var pred in this.PredMap[node])
+      {
+        if (!pred.Equals(node))
+          this.SuccMap[pred].Remove(node);
+      }
+
+      this.SuccMap.Remove(node);
+      this.PredMap.Remove(node);
       this.Nodes.Remove(node);
-      this.IsComputed = false;
+      this.IsReachabilityComputed = false;
     }
 
     public void Reset()
     {
-      this.Edges.Clear();
+      this.PredMap.Clear();
+      this.SuccMap.Clear();
       this.Nodes.Clear();
-      this.PredCache.Clear();
-      this.SuccCache.Clear();
-      this.IsComputed = false;
+      this.IsReachabilityComputed = false;
     }
 
     #endregion
@@ -160,105 +278,145 @@ namespace Whoop
 
     #region helper functions
 
-    private void ComputePredSuccCaches()
+    private void AddNode(Node node)
     {
-      if (this.IsComputed)
+      if (!this.Nodes.Add(node))
         return;
 
-      this.PredCache = new Dictionary<Node, HashSet<Node>>();
-      this.SuccCache = new Dictionary<Node, HashSet<Node>>();
+      this.PredMap.Add(node, new HashSet<Node>());
+      this.SuccMap.Add(node, new HashSet<Node>());
+      this.IsReachabilityComputed = false;
+    }
 
-      foreach (Node n in this.Nodes)
-      {
-        this.PredCache.Add(n, new HashSet<Node>());
-        this.SuccCache.Add(n, new HashSet<Node>());
-      }
+    /// <summary>
+    /// Depth first traversal over the given adjacency map. Nodes are visited in
+    /// the same order as a recursive traversal would, which matters when there is
+    /// a skip node, as only direct neighbours of the start node are skipped.
+    /// </summary>
+    private HashSet<Node> ComputeNested(Node node, Dictionary<Node, HashSet<Node>> adjacency,
+      Node skipNode, bool hasSkipNode)
+    {
+      var nested = new HashSet<Node>();
+      var work = new Stack<IEnumerator<Node>>();
 
-      foreach (var pair in this.Edges)
+      foreach (var next in adjacency[node])
       {
-        HashSet<Node> tmp;
-
-        tmp = this.PredCache[pair.Item2];
-        tmp.Add(pair.Item1);
-        this.PredCache[pair.Item2] = tmp;
+        if (!nested.Add(next))
+          continue;
+        if (hasSkipNode && skipNode != null && skipNode.Equals(next))
+          continue;
 
-        tmp = this.SuccCache[pair.Item1];
-        tmp.Add(pair.Item2);
-        this.SuccCache[pair.Item1] = tmp;
+        work.Push(adjacency[next].GetEnumerator());
+        while (work.Count > 0)
+        {
+          if (!work.Peek().MoveNext())
+          {
+            work.Pop();
+            continue;
+          }
+
+          var current = work.Peek().Current;
+          if (nested.Add(current))
+            work.Push(adjacency[current].GetEnumerator());
+        }
       }
 
-      this.IsComputed = true;
+      return nested;
     }
 
-    private void ComputeNestedPredecessors(Node node, HashSet<Node> nestedPred)
+    private HashSet<Node> GetMemoisedNodes(Node node, bool successors)
     {
-      var predecessors = this.PredCache[node];
-      foreach (var pred in predecessors)
-      {
-        if (nestedPred.Contains(pred))
-          continue;
+      this.ComputeReachability();
 
-        nestedPred.Add(pred);
-        if (!this.PredCache.ContainsKey(pred))
-          continue;
+      var component = this.ComponentOf[node];
+      var reachable = successors ? this.ReachableComponents[component] :
+        this.ReachingComponents[component];
 
-        this.ComputeNestedPredecessors(pred, nestedPred);
+      var nested = new HashSet<Node>();
+      for (int idx = 0; idx < this.Components.Count; idx++)
+      {
+        if (!reachable[idx])
+          continue;
+        nested.UnionWith(this.Components[idx]);
       }
+
+      return nested;
     }
 
-    private void ComputeNestedPredecessors(Node node, HashSet<Node> nestedPred, Node skipNode)
+    /// <summary>
+    /// Condenses the graph into its strongly connected components and computes,
+    /// for each component, the components that it can reach with at least one
+    /// edge and the components that can reach it.
+    /// </summary>
+    private void ComputeReachability()
     {
-      var predecessors = this.PredCache[node];
-      foreach (var pred in predecessors)
-      {
-        if (nestedPred.Contains(pred))
-          continue;
+      if (this.IsReachabilityComputed)
+        return;
 
-        nestedPred.Add(pred);
-        if (skipNode != null && skipNode.Equals(pred))
-          continue;
-        if (!this.PredCache.ContainsKey(pred))
-          continue;
+      var sccs = this.ComputeStronglyConnectedComponents();
 
-        this.ComputeNestedPredecessors(pred, nestedPred);
-      }
-    }
+      this.ComponentOf = new Dictionary<Node, int>();
+      this.Components = new List<List<Node>>();
+      this.IsCyclicComponent = new List<bool>();
+      this.ReachableComponents = new List<BitArray>();
+      this.ReachingComponents = new List<BitArray>();
 
-    private void ComputeNestedSuccessors(Node node, HashSet<Node> nestedSucc)
-    {
-      var successors = this.SuccCache[node];
-      foreach (var succ in successors)
+      foreach (var scc in sccs)
       {
-        if (nestedSucc.Contains(succ))
-          continue;
+        foreach (var member in scc)
+          this.ComponentOf.Add(member, this.Components.Count);
+        this.Components.Add(new List<Node>(scc));
+        this.IsCyclicComponent.Add(false);
+        this.ReachableComponents.Add(new BitArray(sccs.Count));
+        this.ReachingComponents.Add(new BitArray(sccs.Count));
+      }
 
-        nestedSucc.Add(succ);
-        if (!this.SuccCache.ContainsKey(succ))
-          continue;
+      // Components come in reverse topological order, so successor components are
+      // always complete by the time they are merged into their predecessors.
+      for (int idx = 0; idx < this.Components.Count; idx++)
+      {
+        foreach (var member in this.Components[idx])
+        {
+          foreach (var succ in this.SuccMap[member])
+          {
+            var target = this.ComponentOf[succ];
+            if (target == idx)
+            {
+              this.IsCyclicComponent[idx] = true;
+              continue;
+            }
+
+            this.ReachableComponents[idx][target] = true;
+            this.ReachableComponents[idx].Or(this.ReachableComponents[target]);
+          }
+        }
 
-        this.ComputeNestedSuccessors(succ, nestedSucc);
+        if (this.IsCyclicComponent[idx])
+          this.ReachableComponents[idx][idx] = true;
       }
-    }
 
-    private void ComputeNestedSuccessors(Node node, HashSet<Node> nestedSucc, Node skipNode)
-    {
-      var successors = this.SuccCache[node];
-      foreach (var succ in successors)
+      for (int idx = this.Components.Count - 1; idx >= 0; idx--)
       {
-        if (nestedSucc.Contains(succ))
-          continue;
-
-        nestedSucc.Add(succ);
-        if (skipNode != null && skipNode.Equals(succ))
-          continue;
-        if (!this.SuccCache.ContainsKey(succ))
-          continue;
+        foreach (var member in this.Components[idx])
+        {
+          foreach (var pred in this.PredMap[member])
+          {
+            var source = this.ComponentOf[pred];
+            if (source == idx)
+              continue;
+
+            this.ReachingComponents[idx][source] = true;
+            this.ReachingComponents[idx].Or(this.ReachingComponents[source]);
+          }
+        }
 
-        this.ComputeNestedSuccessors(succ, nestedSucc);
+        if (this.IsCyclicComponent[idx])
+          this.ReachingComponents[idx][idx] = true;
       }
+
+      this.IsReachabilityComputed = true;
     }
 
     #endregion
   }
 }
-
@@ -23,12 +23,19 @@ namespace Whoop
     public readonly EntryPoint EntryPoint;
     public readonly string TargetName;
 
-    public Lockset(Variable id, Variable l, EntryPoint ep, string target = "")
+    /// <summary>
+    /// The bit of the lock in the bitvector lockset, or -1 if the lockset has its
+    /// own boolean variable.
+    /// </summary>
+    public readonly int Bit;
+
+    public Lockset(Variable id, Variable l, EntryPoint ep, string target = "", int bit = -1)
     {
       this.Id = id;
       this.Lock = l;
       this.EntryPoint = ep;
       this.TargetName = target;
+      this.Bit = bit;
     }
   }
 }
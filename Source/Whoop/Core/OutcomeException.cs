@@ -0,0 +1,53 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Diagnostics.Contracts;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Thrown when a tool cannot go on. The tool hands the outcome back as its exit
+  /// code, instead of ending the process, so that other threads and the daemon
+  /// that hosts the tool are not taken down with it.
+  /// </summary>
+  public sealed class OutcomeException : Exception
+  {
+    public readonly Outcome Outcome;
+
+    public OutcomeException(Outcome outcome, string message)
+      : base(message)
+    {
+      Contract.Requires(message != null);
+      this.Outcome = outcome;
+    }
+
+    /// <summary>
+    /// Returns the outcome exception that ended a run, looking through the
+    /// exceptions that parallel loops wrap it in.
+    /// </summary>
+    /// <returns>Outcome exception, or null if there is none</returns>
+    /// <param name="e">Exception</param>
+    public static OutcomeException Find(Exception e)
+    {
+      if (e is AggregateException)
+      {
+        foreach (var inner in (e as AggregateException).Flatten().InnerExceptions)
+        {
+          if (inner is OutcomeException)
+            return inner as OutcomeException;
+        }
+      }
+
+      return e as OutcomeException;
+    }
+  }
+}
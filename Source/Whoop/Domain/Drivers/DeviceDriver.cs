@@ -29,6 +29,7 @@ namespace Whoop.Domain.Drivers
 
     public static List<EntryPoint> EntryPoints;
     public static List<EntryPointPair> EntryPointPairs;
+    public static List<EntryPointPair> PrunedEntryPointPairs;
 
     public static List<Module> Modules;
 
@@ -57,10 +58,14 @@ namespace Whoop.Domain.Drivers
       string driverInfoFile = files[files.Count - 1].Substring(0,
         files[files.Count - 1].LastIndexOf(".")) + ".info";
 
+      KernelRules.ParseAndInitialize();
+
       DeviceDriver.EntryPoints = new List<EntryPoint>();
       DeviceDriver.Modules = new List<Module>();
       DeviceDriver.SharedStructInitialiseFunc = "";
 
+      var names = new HashSet<string>();
+
       bool whoopInit = true;
       using(StreamReader file = new StreamReader(driverInfoFile))
       {
@@ -139,7 +144,7 @@ namespace Whoop.Domain.Drivers
             var ep = new EntryPoint(pair[1], pair[0], kernelFunc, module, whoopInit);
             module.EntryPoints.Add(ep);
 
-            if (DeviceDriver.EntryPoints.Any(val => val.Name.Equals(ep.Name)))
+            if (!names.Add(ep.Name))
               continue;
 
             DeviceDriver.EntryPoints.Add(ep);
@@ -155,13 +160,17 @@ namespace Whoop.Domain.Drivers
       }
 
       DeviceDriver.EntryPointPairs = new List<EntryPointPair>();
+      DeviceDriver.PrunedEntryPointPairs = new List<EntryPointPair>();
 
-      foreach (var ep1 in DeviceDriver.EntryPoints)
+      // Entry point names are unique and both checks are symmetric, so visiting
+      // each unordered pair once is enough to find every new pair
+      for (int i = 0; i < DeviceDriver.EntryPoints.Count; i++)
       {
-        foreach (var ep2 in DeviceDriver.EntryPoints)
+        for (int j = i; j < DeviceDriver.EntryPoints.Count; j++)
         {
+          var ep1 = DeviceDriver.EntryPoints[i];
+          var ep2 = DeviceDriver.EntryPoints[j];
           if (!DeviceDriver.CanBePaired(ep1, ep2)) continue;
-          if (!DeviceDriver.IsNewPair(ep1.Name, ep2.Name)) continue;
           if (!DeviceDriver.CanRunConcurrently(ep1, ep2)) continue;
           DeviceDriver.EntryPointPairs.Add(new EntryPointPair(ep1, ep2));
         }
@@ -189,6 +198,75 @@ namespace Whoop.Domain.Drivers
       return pairs;
     }
 
+    /// <summary>
+    /// Prunes the given pair, which is known to be race free, so it is not checked.
+    /// </summary>
+    /// <returns>True if the pair was pruned, false if it is not a pair to check</returns>
+    /// <param name="pair">Entry point pair</param>
+    public static bool PruneEntryPointPair(EntryPointPair pair)
+    {
+      if (!DeviceDriver.EntryPointPairs.Remove(pair))
+        return false;
+      DeviceDriver.PrunedEntryPointPairs.Add(pair);
+      return true;
+    }
+
+    /// <summary>
+    /// Returns the pair of the given entry points.
+    /// </summary>
+    /// <returns>Entry point pair, or null if there is no such pair</returns>
+    /// <param name="ep1">Name of the first entry point</param>
+    /// <param name="ep2">Name of the second entry point</param>
+    public static EntryPointPair GetEntryPointPair(string ep1, string ep2)
+    {
+      return DeviceDriver.EntryPointPairs.Find(val =>
+        val.EntryPoint1.Name.Equals(ep1) && val.EntryPoint2.Name.Equals(ep2));
+    }
+
+    /// <summary>
+    /// Parses the pairs that the engine has pruned, and prunes them again.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    public static void ParsePrunedEntryPointPairs(List<string> files)
+    {
+      string prunedInfoFile = files[files.Count - 1].Substring(0,
+        files[files.Count - 1].LastIndexOf(".")) + ".pruned.info";
+
+      if (!File.Exists(prunedInfoFile))
+        return;
+
+      using(StreamReader file = new StreamReader(prunedInfoFile))
+      {
+        string line;
+        while ((line = file.ReadLine()) != null)
+        {
+          string[] info = line.Split(new string[] { "::" }, StringSplitOptions.None);
+          if (info.Length != 2)
+            continue;
+
+          var pair = DeviceDriver.GetEntryPointPair(info[0], info[1]);
+          if (pair != null)
+            DeviceDriver.PruneEntryPointPair(pair);
+        }
+      }
+    }
+
+    /// <summary>
+    /// Prints the pruned entry point pairs.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    public static void EmitPrunedEntryPointPairs(List<string> files)
+    {
+      string prunedInfoFile = files[files.Count - 1].Substring(0,
+        files[files.Count - 1].LastIndexOf(".")) + ".pruned.info";
+
+      using(StreamWriter file = new StreamWriter(prunedInfoFile))
+      {
+        foreach (var pair in DeviceDriver.PrunedEntryPointPairs)
+          file.WriteLine(pair.EntryPoint1.Name + "::" + pair.EntryPoint2.Name);
+      }
+    }
+
     /// <summary>
     /// Emits the entry point pairs in an XML file.
     /// </summary>
@@ -216,36 +294,28 @@ namespace Whoop.Domain.Drivers
     #region other methods
 
     /// <summary>
-    /// Sets the initial entry point.
+    /// Forgets the device driver information of a previous run.
     /// </summary>
-    /// <param name="ep">Name of the entry point</param>
-    internal static void SetInitEntryPoint(string ep)
+    internal static void Reset()
     {
-      if (DeviceDriver.InitEntryPoint != null)
-      {
-        Console.Error.Write("Cannot have more than one init entry points.");
-        Environment.Exit((int)Outcome.ParsingError);
-      }
-
-      DeviceDriver.InitEntryPoint = ep;
+      DeviceDriver.EntryPoints = null;
+      DeviceDriver.EntryPointPairs = null;
+      DeviceDriver.PrunedEntryPointPairs = null;
+      DeviceDriver.Modules = null;
+      DeviceDriver.InitEntryPoint = null;
+      DeviceDriver.SharedStructInitialiseFunc = null;
     }
 
     /// <summary>
-    /// Checks if the given entry points form a new pair.
+    /// Sets the initial entry point.
     /// </summary>
-    /// <returns>Boolean value</returns>
-    /// <param name="ep1">Name of first entry point</param>
-    /// <param name="ep2">Name of second entry point</param>
-    private static bool IsNewPair(string ep1, string ep2)
+    /// <param name="ep">Name of the entry point</param>
+    internal static void SetInitEntryPoint(string ep)
     {
-      if (DeviceDriver.EntryPointPairs.Exists(val =>
-        (val.EntryPoint1.Name.Equals(ep1) && (val.EntryPoint2.Name.Equals(ep2))) ||
-        (val.EntryPoint1.Name.Equals(ep2) && (val.EntryPoint2.Name.Equals(ep1)))))
-      {
-        return false;
-      }
+      if (DeviceDriver.InitEntryPoint != null)
+        throw new OutcomeException(Outcome.ParsingError, "Cannot have more than one init entry points.");
 
-      return true;
+      DeviceDriver.InitEntryPoint = ep;
     }
 
     /// <summary>
@@ -287,7 +357,9 @@ namespace Whoop.Domain.Drivers
     }
 
     /// <summary>
-    /// Checks if the given entry points can run concurrently.
+    /// Checks if the given entry points can run concurrently. The kernel serialises
+    /// two entry points if it holds a common lock around both, or if one of them is
+    /// exclusive within the module API of the other.
     /// </summary>
     /// <returns>Boolean value</returns>
     /// <param name="ep1">First entry point</param>
@@ -299,33 +371,10 @@ namespace Whoop.Domain.Drivers
       if (ep1.IsExit || ep2.IsExit)
         return false;
 
-      if (DeviceDriver.HasKernelImposedDeviceLock(ep1.API, ep1.Module) &&
-          DeviceDriver.HasKernelImposedDeviceLock(ep2.API, ep2.Module))
+      if ((ep1.LockMask & ep2.LockMask) != 0)
         return false;
-      if (DeviceDriver.HasKernelImposedPowerLock(ep1.API) &&
-          DeviceDriver.HasKernelImposedPowerLock(ep2.API))
-        return false;
-      if (DeviceDriver.HasKernelImposedRTNL(ep1.API) &&
-          DeviceDriver.HasKernelImposedRTNL(ep2.API))
-        return false;
-      if (DeviceDriver.HasKernelImposedTxLock(ep1.API) &&
-          DeviceDriver.HasKernelImposedTxLock(ep2.API))
-        return false;
-
-      if (DeviceDriver.IsPowerManagementAPI(ep1.API) &&
-          DeviceDriver.IsPowerManagementAPI(ep2.API))
-        return false;
-      if (DeviceDriver.IsCalledWithNetpollDisabled(ep1.API) &&
-          DeviceDriver.IsCalledWithNetpollDisabled(ep2.API))
-        return false;
-
-      if (DeviceDriver.IsFileOperationsSerialised(ep1, ep2))
-        return false;
-      if (DeviceDriver.IsBlockOperationsSerialised(ep1, ep2))
-        return false;
-      if (DeviceDriver.IsUSBOperationsSerialised(ep1, ep2))
-        return false;
-      if (DeviceDriver.IsNFCOperationsSerialised(ep1, ep2))
+      if ((ep1.ExclusiveMask & ep2.ScopeMask) != 0 ||
+          (ep2.ExclusiveMask & ep1.ScopeMask) != 0)
         return false;
 
       return true;
@@ -336,20 +385,7 @@ namespace Whoop.Domain.Drivers
     /// </summary>
     internal static bool HasKernelImposedDeviceLock(string name, Module module)
     {
-      if (name.Equals("probe") || name.Equals("remove") ||
-          name.Equals("shutdown"))
-        return true;
-
-      // power management API
-      if (name.Equals("prepare") || name.Equals("complete") ||
-          name.Equals("resume") || name.Equals("suspend") ||
-          name.Equals("freeze") || name.Equals("poweroff") ||
-          name.Equals("restore") || name.Equals("thaw") ||
-          name.Equals("runtime_resume") || name.Equals("runtime_suspend") ||
-          name.Equals("runtime_idle"))
-        return true;
-
-      return false;
+      return KernelRules.HoldsLock("device_lock", name);
     }
 
     /// <summary>
@@ -359,12 +395,7 @@ namespace Whoop.Domain.Drivers
     /// <param name="ep">Name of entry point</param>
     internal static bool HasKernelImposedPowerLock(string ep)
     {
-      // power management API
-      if (ep.Equals("runtime_resume") || ep.Equals("runtime_suspend") ||
-          ep.Equals("runtime_idle"))
-        return true;
-
-      return false;
+      return KernelRules.HoldsLock("power_lock", ep);
     }
 
     /// <summary>
@@ -374,50 +405,7 @@ namespace Whoop.Domain.Drivers
     /// <param name="ep">Name of entry point</param>
     internal static bool HasKernelImposedRTNL(string ep)
     {
-      // network device management API
-      if (ep.Equals("ndo_init") || ep.Equals("ndo_uninit") ||
-          ep.Equals("ndo_open") || ep.Equals("ndo_stop") ||
-          ep.Equals("ndo_start_xmit") ||
-          ep.Equals("ndo_validate_addr") ||
-          ep.Equals("ndo_change_mtu") ||
-          ep.Equals("ndo_get_stats64") || ep.Equals("ndo_get_stats") ||
-          ep.Equals("ndo_poll_controller") || ep.Equals("ndo_netpoll_setup") ||
-          ep.Equals("ndo_netpoll_cleanup") ||
-          ep.Equals("ndo_fix_features") || ep.Equals("ndo_set_features") ||
-          ep.Equals("ndo_set_mac_address") ||
-          ep.Equals("ndo_do_ioctl") ||
-          ep.Equals("ndo_set_rx_mode"))
-        return true;
-
-      // ethernet device management API
-      if (ep.Equals("get_settings") || ep.Equals("set_settings") ||
-          ep.Equals("get_drvinfo") ||
-          ep.Equals("get_regs_len") || ep.Equals("get_regs") ||
-          ep.Equals("get_wol") || ep.Equals("set_wol") ||
-          ep.Equals("get_msglevel") || ep.Equals("set_msglevel") ||
-          ep.Equals("nway_reset") || ep.Equals("get_link") ||
-          ep.Equals("get_eeprom_len") ||
-          ep.Equals("get_eeprom") || ep.Equals("set_eeprom") ||
-          ep.Equals("get_coalesce") || ep.Equals("set_coalesce") ||
-          ep.Equals("get_ringparam") || ep.Equals("set_ringparam") ||
-          ep.Equals("get_pauseparam") || ep.Equals("set_pauseparam") ||
-          ep.Equals("self_test") || ep.Equals("get_strings") ||
-          ep.Equals("set_phys_id") || ep.Equals("get_ethtool_stats") ||
-          ep.Equals("begin") || ep.Equals("complete") ||
-          ep.Equals("get_priv_flags") || ep.Equals("set_priv_flags") ||
-          ep.Equals("get_sset_count") ||
-          ep.Equals("get_rxnfc") || ep.Equals("set_rxnfc") ||
-          ep.Equals("flash_device") || ep.Equals("reset") ||
-          ep.Equals("get_rxfh_indir_size") ||
-          ep.Equals("get_rxfh_indir") || ep.Equals("set_rxfh_indir") ||
-          ep.Equals("get_channels") || ep.Equals("set_channels") ||
-          ep.Equals("get_dump_flag") || ep.Equals("get_dump_data") ||
-          ep.Equals("set_dump") || ep.Equals("get_ts_info") ||
-          ep.Equals("get_module_info") || ep.Equals("get_module_eeprom") ||
-          ep.Equals("get_eee") || ep.Equals("set_eee"))
-        return true;
-
-      return false;
+      return KernelRules.HoldsLock("rtnl_lock", ep);
     }
 
     /// <summary>
@@ -427,127 +415,7 @@ namespace Whoop.Domain.Drivers
     /// <param name="ep">Name of entry point</param>
     internal static bool HasKernelImposedTxLock(string ep)
     {
-      // network device management API
-      if (ep.Equals("ndo_start_xmit"))
-        return true;
-
-      return false;
-    }
-
-    /// <summary>
-    /// Checks if the file operation entry points have been serialised by
-    /// the kernel.
-    /// </summary>
-    /// <returns>Boolean value</returns>
-    /// <param name="ep">Name of entry point</param>
-    internal static bool IsFileOperationsSerialised(EntryPoint ep1, EntryPoint ep2)
-    {
-      // file_operations API
-      if (!ep1.Module.API.Equals("file_operations") ||
-          !ep2.Module.API.Equals("file_operations"))
-        return false;
-
-      if (ep1.API.Equals("release") || ep2.API.Equals("release"))
-        return true;
-
-      if (ep1.API.Equals("mmap") && ep2.API.Equals("mmap"))
-        return true;
-
-      return false;
-    }
-
-    /// <summary>
-    /// Checks if the usb operation entry points have been serialised by
-    /// the kernel.
-    /// </summary>
-    /// <returns>Boolean value</returns>
-    /// <param name="ep">Name of entry point</param>
-    internal static bool IsUSBOperationsSerialised(EntryPoint ep1, EntryPoint ep2)
-    {
-      // usb_serial_driver API
-      if (!ep1.Module.API.Equals("usb_serial_driver") ||
-        !ep2.Module.API.Equals("usb_serial_driver"))
-        return false;
-
-      if (ep1.API.Equals("port_probe") || ep2.API.Equals("port_probe"))
-        return true;
-      if (ep1.API.Equals("attach") || ep2.API.Equals("attach"))
-        return true;
-      if (ep1.API.Equals("port_remove") || ep2.API.Equals("port_remove"))
-        return true;
-      if (ep1.API.Equals("open") || ep2.API.Equals("open"))
-        return true;
-      if (ep1.API.Equals("process_read_urb") || ep2.API.Equals("process_read_urb"))
-        return true;
-
-      if ((ep1.API.Equals("tiocmget") || ep1.API.Equals("tiocmset") ||
-          ep1.API.Equals("tiocmiwait") || ep1.API.Equals("get_icount") ||
-          ep1.API.Equals("ioctl")) &&
-          (ep2.API.Equals("tiocmget") || ep2.API.Equals("tiocmset") ||
-          ep2.API.Equals("tiocmiwait") || ep2.API.Equals("get_icount") ||
-          ep2.API.Equals("ioctl")))
-        return true;
-
-      if (ep1.API.Equals("set_termios") && ep2.API.Equals("set_termios"))
-        return true;
-      if (ep1.API.Equals("dtr_rts") && ep2.API.Equals("dtr_rts"))
-        return true;
-
-      return false;
-    }
-
-    /// <summary>
-    /// Checks if the nfc operation entry points have been serialised by
-    /// the kernel.
-    /// </summary>
-    /// <returns>Boolean value</returns>
-    /// <param name="ep">Name of entry point</param>
-    internal static bool IsNFCOperationsSerialised(EntryPoint ep1, EntryPoint ep2)
-    {
-      // nfc_ops API
-      if (!ep1.Module.API.Equals("nfc_ops") ||
-        !ep2.Module.API.Equals("nfc_ops"))
-        return false;
-
-      // NFC API
-      if ((ep1.API.Equals("dev_up") || ep1.API.Equals("dev_down") ||
-          ep1.API.Equals("dep_link_up") || ep1.API.Equals("dep_link_down") ||
-          ep1.API.Equals("activate_target") || ep1.API.Equals("deactivate_target") ||
-          ep1.API.Equals("im_transceive") || ep1.API.Equals("tm_send") ||
-          ep1.API.Equals("start_poll") || ep1.API.Equals("stop_poll")) &&
-          (ep2.API.Equals("dev_up") || ep2.API.Equals("dev_down") ||
-          ep2.API.Equals("dep_link_up") || ep2.API.Equals("dep_link_down") ||
-          ep2.API.Equals("activate_target") || ep2.API.Equals("deactivate_target") ||
-          ep2.API.Equals("im_transceive") || ep2.API.Equals("tm_send") ||
-          ep2.API.Equals("start_poll") || ep2.API.Equals("stop_poll")))
-        return true;
-
-      return false;
-    }
-
-    /// <summary>
-    /// Checks if the block operation entry points have been serialised by
-    /// the kernel.
-    /// </summary>
-    /// <returns>Boolean value</returns>
-    /// <param name="ep">Name of entry point</param>
-    internal static bool IsBlockOperationsSerialised(EntryPoint ep1, EntryPoint ep2)
-    {
-      // file_operations API
-      if (!ep1.Module.API.Equals("block_device_operations") ||
-        !ep2.Module.API.Equals("block_device_operations"))
-        return false;
-
-      if (ep1.API.Equals("release") || ep2.API.Equals("release"))
-        return true;
-      if (ep1.API.Equals("revalidate_disk") || ep2.API.Equals("revalidate_disk"))
-        return true;
-      if (ep1.API.Equals("open") && ep2.API.Equals("release"))
-        return true;
-      if (ep1.API.Equals("release") && ep2.API.Equals("open"))
-        return true;
-
-      return false;
+      return KernelRules.HoldsLock("tx_lock", ep);
     }
 
     /// <summary>
@@ -557,12 +425,7 @@ namespace Whoop.Domain.Drivers
     /// <param name="ep">Name of entry point</param>
     internal static bool IsNetworkAPI(string ep)
     {
-      if (DeviceDriver.HasKernelImposedRTNL(ep))
-        return true;
-      if (ep.Equals("ndo_tx_timeout"))
-        return true;
-
-      return false;
+      return KernelRules.IsInClass("network", ep);
     }
 
     /// <summary>
@@ -572,16 +435,7 @@ namespace Whoop.Domain.Drivers
     /// <param name="ep">Name of entry point</param>
     internal static bool IsPowerManagementAPI(string ep)
     {
-      // power management API
-      if (ep.Equals("prepare") || ep.Equals("complete") ||
-        ep.Equals("resume") || ep.Equals("suspend") ||
-        ep.Equals("freeze") || ep.Equals("poweroff") ||
-        ep.Equals("restore") || ep.Equals("thaw") ||
-        ep.Equals("runtime_resume") || ep.Equals("runtime_suspend") ||
-        ep.Equals("runtime_idle"))
-        return true;
-
-      return false;
+      return KernelRules.IsInClass("power_management", ep);
     }
 
     /// <summary>
@@ -593,12 +447,7 @@ namespace Whoop.Domain.Drivers
     {
       if (!DeviceDriver.Modules.Any(val => val.API.Equals("net_device_ops")))
         return false;
-
-      if (ep.Equals("suspend") || ep.Equals("freeze") ||
-          ep.Equals("poweroff") || ep.Equals("runtime_suspend") ||
-          ep.Equals("shutdown"))
-        return true;
-      return false;
+      return KernelRules.IsInClass("disables_network", ep);
     }
 
     /// <summary>
@@ -608,27 +457,7 @@ namespace Whoop.Domain.Drivers
     /// <param name="ep">Name of entry point</param>
     internal static bool IsCalledWithNetworkDisabled(string ep)
     {
-      if (ep.Equals("resume") || ep.Equals("restore") ||
-        ep.Equals("thaw") || ep.Equals("runtime_resume"))
-        return true;
-      return false;
-    }
-
-    /// <summary>
-    /// Checks if the entry point has been called with netpoll disabled.
-    /// Netpoll is included in this set of entry points for convenience.
-    /// </summary>
-    /// <returns>Boolean value</returns>
-    /// <param name="ep">Name of entry point</param>
-    private static bool IsCalledWithNetpollDisabled(string ep)
-    {
-      // network device management API
-      if (ep.Equals("ndo_poll_controller") ||
-          ep.Equals("ndo_open") || ep.Equals("ndo_stop") ||
-          ep.Equals("ndo_validate_addr"))
-        return true;
-
-      return false;
+      return KernelRules.IsInClass("network_disabled", ep);
     }
 
     #endregion
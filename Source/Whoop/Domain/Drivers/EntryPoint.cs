@@ -40,6 +40,10 @@ namespace Whoop.Domain.Drivers
     public readonly bool IsNetLocked;
     public readonly bool IsTxLocked;
 
+    internal readonly ulong LockMask;
+    internal readonly ulong ExclusiveMask;
+    internal readonly ulong ScopeMask;
+
     internal Graph<Implementation> OriginalCallGraph;
     internal Graph<InstrumentationRegion> CallGraph;
 
@@ -128,6 +132,10 @@ namespace Whoop.Domain.Drivers
       else
         this.IsTxLocked = false;
 
+      this.LockMask = KernelRules.GetLockMask(api, module.API);
+      this.ExclusiveMask = KernelRules.GetExclusiveMask(api, module.API);
+      this.ScopeMask = KernelRules.GetScopeMask(module.API);
+
       if (DeviceDriver.IsGoingToDisableNetwork(api))
         this.IsGoingToDisableNetwork = true;
       else
@@ -157,7 +165,16 @@ namespace Whoop.Domain.Drivers
 
     internal void RebuildCallGraph(AnalysisContext ac)
     {
-      var callGraph = new Graph<InstrumentationRegion>();
+      // The slicing and instrumentation passes query transitive callers and
+      // callees repeatedly, so reachability is memoised.
+      var callGraph = new Graph<InstrumentationRegion>(true);
+
+      var regionMap = new Dictionary<string, InstrumentationRegion>();
+      foreach (var region in ac.InstrumentationRegions)
+      {
+        if (!regionMap.ContainsKey(region.Implementation().Name))
+          regionMap.Add(region.Implementation().Name, region);
+      }
 
       foreach (var region in ac.InstrumentationRegions)
       {
@@ -165,10 +182,9 @@ namespace Whoop.Domain.Drivers
         {
           foreach (var call in block.Cmds.OfType<CallCmd>())
           {
-            if (!ac.InstrumentationRegions.Any(val => val.Implementation().Name.Equals(call.callee)))
+            InstrumentationRegion calleeRegion = null;
+            if (!regionMap.TryGetValue(call.callee, out calleeRegion))
               continue;
-            var calleeRegion = ac.InstrumentationRegions.Find(val =>
-              val.Implementation().Name.Equals(call.callee));
             callGraph.AddEdge(region, calleeRegion);
           }
         }
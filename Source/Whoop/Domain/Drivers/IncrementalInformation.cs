@@ -0,0 +1,431 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Linq;
+using System.Security.Cryptography;
+using System.Text;
+
+using Microsoft.Boogie;
+
+namespace Whoop.Domain.Drivers
+{
+  /// <summary>
+  /// Information that is kept across runs for incremental verification. For each
+  /// entry point it stores a fingerprint of the code that the entry point can reach,
+  /// and for each entry point pair it stores the outcome of the last verification.
+  /// A pair is pending if it has no stored outcome. It also stores fingerprints of
+  /// the per resource checking programs that have been proved race-free.
+  /// </summary>
+  public static class IncrementalInformation
+  {
+    #region fields
+
+    private static Dictionary<string, string> Fingerprints;
+    private static Dictionary<string, Tuple<int, int, string, string>> Outcomes;
+
+    private static HashSet<string> RaceFreeResources = new HashSet<string>();
+    private static HashSet<string> UsedResources = new HashSet<string>();
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// Parses the information of the previous run, if there is one.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    public static void ParseAndInitialize(List<string> files)
+    {
+      string incrementalInfoFile = IncrementalInformation.GetFileName(files);
+
+      IncrementalInformation.Fingerprints = new Dictionary<string, string>();
+      IncrementalInformation.Outcomes = new Dictionary<string, Tuple<int, int, string, string>>();
+      IncrementalInformation.RaceFreeResources = new HashSet<string>();
+      IncrementalInformation.UsedResources = new HashSet<string>();
+
+      if (!File.Exists(incrementalInfoFile))
+        return;
+
+      using(StreamReader file = new StreamReader(incrementalInfoFile))
+      {
+        string line;
+
+        while ((line = file.ReadLine()) != null)
+        {
+          string type = line.Trim(new char[] { '<', '>' });
+
+          while ((line = file.ReadLine()) != null)
+          {
+            if (line.Equals("</>")) break;
+            string[] info = line.Split(new string[] { "::" }, StringSplitOptions.None);
+
+            if (type.Equals("fingerprints") && info.Length == 2)
+            {
+              IncrementalInformation.Fingerprints[info[0]] = info[1];
+            }
+            else if (type.Equals("outcomes") && info.Length == 6)
+            {
+              IncrementalInformation.Outcomes[info[0] + "::" + info[1]] =
+                new Tuple<int, int, string, string>(Int32.Parse(info[2]), Int32.Parse(info[3]),
+                  IncrementalInformation.Decode(info[4]), IncrementalInformation.Decode(info[5]));
+            }
+            else if (type.Equals("resources") && info.Length == 1)
+            {
+              IncrementalInformation.RaceFreeResources.Add(info[0]);
+            }
+          }
+        }
+      }
+    }
+
+    /// <summary>
+    /// Fingerprints the entry points of the given program and drops the stored
+    /// outcomes of all pairs with an entry point whose fingerprint has changed.
+    /// </summary>
+    /// <param name="ac">Analysis context of the original program</param>
+    public static void ComputeFingerprints(AnalysisContext ac)
+    {
+      Contract.Requires(ac != null);
+
+      // The key identifies the options of the tools that run after the engine, as
+      // these can change the outcomes as well. The arguments of the run are used
+      // instead of those of the process, which belong to the daemon if there is one
+      var context = new StringBuilder();
+      context.AppendLine(WhoopCommandLineOptions.Get().IncrementalKey);
+      foreach (var arg in WhoopCommandLineOptions.Get().Arguments)
+        context.AppendLine(arg);
+      foreach (var decl in ac.TopLevelDeclarations)
+      {
+        if (decl is Implementation || decl is Procedure || decl is GlobalVariable)
+          continue;
+        context.Append(IncrementalInformation.Print(decl));
+      }
+
+      // The init and shared struct initialisation functions set up the state that
+      // every pair starts from, so they are part of every fingerprint
+      if (DeviceDriver.InitEntryPoint != null)
+        context.Append(IncrementalInformation.PrintReachableCode(ac, DeviceDriver.InitEntryPoint));
+      if (!DeviceDriver.SharedStructInitialiseFunc.Equals(""))
+        context.Append(IncrementalInformation.PrintReachableCode(ac, DeviceDriver.SharedStructInitialiseFunc));
+
+      var fingerprints = new Dictionary<string, string>();
+      foreach (var ep in DeviceDriver.EntryPoints)
+      {
+        var name = ep.IsClone ? ep.Name.Remove(ep.Name.IndexOf("#net")) : ep.Name;
+        fingerprints[ep.Name] = IncrementalInformation.ComputeHash(context.ToString() +
+          IncrementalInformation.PrintReachableCode(ac, name));
+      }
+
+      var changed = new HashSet<string>(fingerprints.Keys.Where(val =>
+        !IncrementalInformation.Fingerprints.ContainsKey(val) ||
+        !IncrementalInformation.Fingerprints[val].Equals(fingerprints[val])));
+
+      var outcomes = new Dictionary<string, Tuple<int, int, string, string>>();
+      foreach (var pair in DeviceDriver.EntryPointPairs)
+      {
+        if (changed.Contains(pair.EntryPoint1.Name) || changed.Contains(pair.EntryPoint2.Name))
+          continue;
+
+        Tuple<int, int, string, string> outcome = null;
+        if (IncrementalInformation.Outcomes.TryGetValue(IncrementalInformation.GetKey(pair), out outcome))
+          outcomes.Add(IncrementalInformation.GetKey(pair), outcome);
+      }
+
+      IncrementalInformation.Fingerprints = fingerprints;
+      IncrementalInformation.Outcomes = outcomes;
+    }
+
+    /// <summary>
+    /// Returns the fingerprint of the given entry point, as computed by the engine.
+    /// </summary>
+    /// <returns>Fingerprint, or null if there is none</returns>
+    /// <param name="ep">Entry point</param>
+    public static string GetFingerprint(EntryPoint ep)
+    {
+      Contract.Requires(ep != null);
+      string fingerprint = null;
+      IncrementalInformation.Fingerprints.TryGetValue(ep.Name, out fingerprint);
+      return fingerprint;
+    }
+
+    /// <summary>
+    /// Checks if the given pair has to be verified.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="pair">Entry point pair</param>
+    public static bool IsPending(EntryPointPair pair)
+    {
+      return !IncrementalInformation.Outcomes.ContainsKey(IncrementalInformation.GetKey(pair));
+    }
+
+    /// <summary>
+    /// Checks if the given entry point takes part in a pair that has to be verified.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="ep">Entry point</param>
+    public static bool IsPending(EntryPoint ep)
+    {
+      return DeviceDriver.EntryPointPairs.Any(val => IncrementalInformation.IsPending(val) &&
+        (val.EntryPoint1.Name.Equals(ep.Name) || val.EntryPoint2.Name.Equals(ep.Name)));
+    }
+
+    /// <summary>
+    /// Returns the stored outcome of the given pair.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="pair">Entry point pair</param>
+    /// <param name="verified">Number of verified checks</param>
+    /// <param name="errors">Number of errors</param>
+    /// <param name="output">Captured standard output and error</param>
+    public static bool TryGetOutcome(EntryPointPair pair, out int verified, out int errors,
+      out Tuple<string, string> output)
+    {
+      Tuple<int, int, string, string> outcome = null;
+      verified = 0;
+      errors = 0;
+      output = null;
+
+      if (!IncrementalInformation.Outcomes.TryGetValue(IncrementalInformation.GetKey(pair), out outcome))
+        return false;
+
+      verified = outcome.Item1;
+      errors = outcome.Item2;
+      output = new Tuple<string, string>(outcome.Item3, outcome.Item4);
+      return true;
+    }
+
+    /// <summary>
+    /// Stores the outcome of the given pair.
+    /// </summary>
+    /// <param name="pair">Entry point pair</param>
+    /// <param name="verified">Number of verified checks</param>
+    /// <param name="errors">Number of errors</param>
+    /// <param name="output">Captured standard output and error</param>
+    public static void RegisterOutcome(EntryPointPair pair, int verified, int errors,
+      Tuple<string, string> output)
+    {
+      Contract.Requires(pair != null && output != null);
+      IncrementalInformation.Outcomes[IncrementalInformation.GetKey(pair)] =
+        new Tuple<int, int, string, string>(verified, errors, output.Item1, output.Item2);
+    }
+
+    /// <summary>
+    /// Fingerprints the given per resource checking program. The fingerprint covers
+    /// the whole program and the options that the tool runs with.
+    /// </summary>
+    /// <returns>Fingerprint</returns>
+    /// <param name="ac">Analysis context of the checking program</param>
+    public static string ComputeFingerprint(AnalysisContext ac)
+    {
+      Contract.Requires(ac != null);
+
+      var text = new StringBuilder();
+      text.AppendLine(WhoopCommandLineOptions.Get().IncrementalKey);
+      foreach (var arg in WhoopCommandLineOptions.Get().Arguments)
+        text.AppendLine(arg);
+      foreach (var decl in ac.TopLevelDeclarations)
+        text.Append(IncrementalInformation.Print(decl));
+
+      return IncrementalInformation.ComputeHash(text.ToString());
+    }
+
+    /// <summary>
+    /// Checks if the checking program with the given fingerprint has been proved
+    /// race-free before.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="fingerprint">Fingerprint</param>
+    public static bool IsRaceFree(string fingerprint)
+    {
+      Contract.Requires(fingerprint != null);
+      lock (IncrementalInformation.RaceFreeResources)
+      {
+        if (!IncrementalInformation.RaceFreeResources.Contains(fingerprint))
+          return false;
+        IncrementalInformation.UsedResources.Add(fingerprint);
+        return true;
+      }
+    }
+
+    /// <summary>
+    /// Stores that the checking program with the given fingerprint is race-free.
+    /// </summary>
+    /// <param name="fingerprint">Fingerprint</param>
+    public static void RegisterRaceFree(string fingerprint)
+    {
+      Contract.Requires(fingerprint != null);
+      lock (IncrementalInformation.RaceFreeResources)
+      {
+        IncrementalInformation.RaceFreeResources.Add(fingerprint);
+        IncrementalInformation.UsedResources.Add(fingerprint);
+      }
+    }
+
+    /// <summary>
+    /// Prints the incremental verification information.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    public static void ToFile(List<string> files)
+    {
+      using(StreamWriter file = new StreamWriter(IncrementalInformation.GetFileName(files)))
+      {
+        file.WriteLine("<fingerprints>");
+        foreach (var fingerprint in IncrementalInformation.Fingerprints)
+          file.WriteLine(fingerprint.Key + "::" + fingerprint.Value);
+        file.WriteLine("</>");
+
+        file.WriteLine("<outcomes>");
+        foreach (var outcome in IncrementalInformation.Outcomes)
+        {
+          file.WriteLine(outcome.Key + "::" + outcome.Value.Item1 + "::" + outcome.Value.Item2 + "::" +
+            IncrementalInformation.Encode(outcome.Value.Item3) + "::" +
+            IncrementalInformation.Encode(outcome.Value.Item4));
+        }
+        file.WriteLine("</>");
+
+        // Only the fingerprints of this run are kept, unless this run did not look
+        // at any, so that fingerprints of old versions of the code do not pile up
+        file.WriteLine("<resources>");
+        var resources = IncrementalInformation.UsedResources.Count > 0 ?
+          IncrementalInformation.UsedResources : IncrementalInformation.RaceFreeResources;
+        foreach (var resource in resources)
+          file.WriteLine(resource);
+        file.WriteLine("</>");
+      }
+    }
+
+    #endregion
+
+    #region other methods
+
+    private static string GetFileName(List<string> files)
+    {
+      return files[files.Count - 1].Substring(0,
+        files[files.Count - 1].LastIndexOf(".")) + ".incremental.info";
+    }
+
+    private static string GetKey(EntryPointPair pair)
+    {
+      return pair.EntryPoint1.Name + "::" + pair.EntryPoint2.Name;
+    }
+
+    /// <summary>
+    /// Prints the procedures and implementations that are reachable from the given
+    /// implementation, together with the global variables that they access. These
+    /// include the memory regions and the locks that the code touches.
+    /// </summary>
+    /// <returns>Printed code</returns>
+    /// <param name="ac">Analysis context</param>
+    /// <param name="name">Name of the root implementation</param>
+    private static string PrintReachableCode(AnalysisContext ac, string name)
+    {
+      var procedures = new SortedDictionary<string, Procedure>(StringComparer.Ordinal);
+      var globals = new SortedDictionary<string, Variable>(StringComparer.Ordinal);
+      var worklist = new Stack<string>();
+      worklist.Push(name);
+
+      while (worklist.Count > 0)
+      {
+        var next = worklist.Pop();
+        if (procedures.ContainsKey(next))
+          continue;
+
+        var proc = ac.TopLevelDeclarations.FindByName<Procedure>(next);
+        if (proc == null)
+          continue;
+        procedures.Add(next, proc);
+
+        var impl = ac.GetImplementation(next);
+        if (impl == null)
+          continue;
+
+        var collector = new ReferenceCollector();
+        collector.VisitImplementation(impl);
+        foreach (var reference in collector.Names)
+          worklist.Push(reference);
+        foreach (var global in collector.Globals)
+          globals[global.Name] = global;
+      }
+
+      var code = new StringBuilder();
+      foreach (var proc in procedures)
+      {
+        code.Append(IncrementalInformation.Print(proc.Value));
+        var impl = ac.GetImplementation(proc.Key);
+        if (impl != null)
+          code.Append(IncrementalInformation.Print(impl));
+      }
+
+      foreach (var global in globals.Values)
+        code.Append(IncrementalInformation.Print(global));
+
+      return code.ToString();
+    }
+
+    private static string Print(Declaration decl)
+    {
+      using (var writer = new StringWriter())
+      {
+        decl.Emit(new TokenTextWriter(writer), 0);
+        return writer.ToString();
+      }
+    }
+
+    private static string ComputeHash(string text)
+    {
+      using (var sha = SHA1.Create())
+      {
+        var hash = sha.ComputeHash(Encoding.UTF8.GetBytes(text));
+        return BitConverter.ToString(hash).Replace("-", "").ToLower();
+      }
+    }
+
+    private static string Encode(string text)
+    {
+      return Convert.ToBase64String(Encoding.UTF8.GetBytes(text));
+    }
+
+    private static string Decode(string text)
+    {
+      return Encoding.UTF8.GetString(Convert.FromBase64String(text));
+    }
+
+    /// <summary>
+    /// Collects the names of the procedures, functions and variables that an
+    /// implementation refers to, and the global variables that it accesses.
+    /// </summary>
+    private sealed class ReferenceCollector : StandardVisitor
+    {
+      public HashSet<string> Names = new HashSet<string>();
+      public HashSet<Variable> Globals = new HashSet<Variable>();
+
+      public override Cmd VisitCallCmd(CallCmd node)
+      {
+        this.Names.Add(node.callee);
+        return base.VisitCallCmd(node);
+      }
+
+      public override Expr VisitIdentifierExpr(IdentifierExpr node)
+      {
+        this.Names.Add(node.Name);
+        if (node.Decl is GlobalVariable)
+          this.Globals.Add(node.Decl);
+        return base.VisitIdentifierExpr(node);
+      }
+    }
+
+    #endregion
+  }
+}
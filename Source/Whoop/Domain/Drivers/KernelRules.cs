@@ -0,0 +1,311 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Linq;
+
+namespace Whoop.Domain.Drivers
+{
+  /// <summary>
+  /// The knowledge of which kernel APIs the kernel serialises, read from a rules
+  /// file instead of being spelled out in code. The rules are compiled into bit
+  /// masks over interned API identifiers: each lock and each exclusive rule gets
+  /// a bit, so two entry points are serialised if their masks intersect.
+  /// </summary>
+  internal static class KernelRules
+  {
+    #region fields
+
+    private static Dictionary<string, int> ApiIds;
+
+    private static Dictionary<string, ulong> ClassBits;
+    private static Dictionary<string, ulong> LockBits;
+    private static List<ulong> ClassMasks;
+    private static List<ulong> GlobalLockMasks;
+
+    private static Dictionary<string, Dictionary<int, ulong>> ScopedLockMasks;
+    private static Dictionary<string, Dictionary<int, ulong>> ExclusiveMasks;
+    private static Dictionary<string, ulong> ScopeMasks;
+
+    private static Dictionary<string, List<int>> NamedApis;
+
+    private static int NextLockBit;
+    private static int NextExclusiveBit;
+
+    #endregion
+
+    #region internal API
+
+    /// <summary>
+    /// Parses and compiles the kernel rules of the current run.
+    /// </summary>
+    internal static void ParseAndInitialize()
+    {
+      KernelRules.ApiIds = new Dictionary<string, int>();
+      KernelRules.ClassBits = new Dictionary<string, ulong>();
+      KernelRules.LockBits = new Dictionary<string, ulong>();
+      KernelRules.ClassMasks = new List<ulong>();
+      KernelRules.GlobalLockMasks = new List<ulong>();
+      KernelRules.ScopedLockMasks = new Dictionary<string, Dictionary<int, ulong>>();
+      KernelRules.ExclusiveMasks = new Dictionary<string, Dictionary<int, ulong>>();
+      KernelRules.ScopeMasks = new Dictionary<string, ulong>();
+      KernelRules.NamedApis = new Dictionary<string, List<int>>();
+      KernelRules.NextLockBit = 0;
+      KernelRules.NextExclusiveBit = 0;
+
+      string rulesFile = KernelRules.GetFileName();
+      if (!File.Exists(rulesFile))
+        KernelRules.Fail("Cannot find the kernel rules file " + rulesFile + ".");
+
+      using(StreamReader file = new StreamReader(rulesFile))
+      {
+        string line;
+
+        while ((line = file.ReadLine()) != null)
+        {
+          if (line.Trim().Equals("") || line.StartsWith("#"))
+            continue;
+
+          string type = line.Trim(new char[] { '<', '>' });
+
+          while ((line = file.ReadLine()) != null)
+          {
+            if (line.Equals("</>")) break;
+            if (line.Trim().Equals("") || line.StartsWith("#")) continue;
+            string[] info = line.Split(new string[] { "::" }, StringSplitOptions.None);
+
+            if (type.Equals("classes") && info.Length == 2)
+              KernelRules.AddClass(info[0], KernelRules.ParseApis(info[1]));
+            else if (type.Equals("locks") && info.Length == 3)
+              KernelRules.AddLock(info[0], info[1], KernelRules.ParseApis(info[2]));
+            else if (type.Equals("exclusive") && info.Length == 2)
+              KernelRules.AddExclusive(info[0], KernelRules.ParseApis(info[1]));
+            else
+              KernelRules.Fail("Cannot parse the kernel rule " + line + ".");
+          }
+        }
+      }
+    }
+
+    /// <summary>
+    /// Checks if the given API belongs to the given class.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="name">Name of the class</param>
+    /// <param name="api">API of the entry point</param>
+    internal static bool IsInClass(string name, string api)
+    {
+      int id = KernelRules.GetApiId(api);
+      ulong bit = 0;
+      if (id < 0 || !KernelRules.ClassBits.TryGetValue(name, out bit))
+        return false;
+      return (KernelRules.ClassMasks[id] & bit) != 0;
+    }
+
+    /// <summary>
+    /// Checks if the kernel holds the given global lock around the given API.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="name">Name of the lock</param>
+    /// <param name="api">API of the entry point</param>
+    internal static bool HoldsLock(string name, string api)
+    {
+      int id = KernelRules.GetApiId(api);
+      ulong bit = 0;
+      if (id < 0 || !KernelRules.LockBits.TryGetValue(name, out bit))
+        return false;
+      return (KernelRules.GlobalLockMasks[id] & bit) != 0;
+    }
+
+    /// <summary>
+    /// Returns the locks that the kernel holds around the given API of the given
+    /// module API.
+    /// </summary>
+    /// <returns>Lock mask</returns>
+    /// <param name="api">API of the entry point</param>
+    /// <param name="module">API of the module</param>
+    internal static ulong GetLockMask(string api, string module)
+    {
+      int id = KernelRules.GetApiId(api);
+      if (id < 0)
+        return 0;
+      return KernelRules.GlobalLockMasks[id] |
+        KernelRules.GetScopedMask(KernelRules.ScopedLockMasks, module, id);
+    }
+
+    /// <summary>
+    /// Returns the exclusive rules that the given API of the given module API falls
+    /// under.
+    /// </summary>
+    /// <returns>Exclusive mask</returns>
+    /// <param name="api">API of the entry point</param>
+    /// <param name="module">API of the module</param>
+    internal static ulong GetExclusiveMask(string api, string module)
+    {
+      int id = KernelRules.GetApiId(api);
+      if (id < 0)
+        return 0;
+      return KernelRules.GetScopedMask(KernelRules.ExclusiveMasks, module, id);
+    }
+
+    /// <summary>
+    /// Returns the exclusive rules that apply to the entry points of the given
+    /// module API.
+    /// </summary>
+    /// <returns>Scope mask</returns>
+    /// <param name="module">API of the module</param>
+    internal static ulong GetScopeMask(string module)
+    {
+      ulong mask = 0;
+      KernelRules.ScopeMasks.TryGetValue(module, out mask);
+      return mask;
+    }
+
+    #endregion
+
+    #region other methods
+
+    /// <summary>
+    /// Returns the rules file that was given on the command line. Otherwise the
+    /// rules file is looked up next to the Whoop declarations, and then in the
+    /// model directory next to the binaries.
+    /// </summary>
+    /// <returns>File name</returns>
+    private static string GetFileName()
+    {
+      if (!WhoopCommandLineOptions.Get().KernelRulesFile.Equals(""))
+        return WhoopCommandLineOptions.Get().KernelRulesFile;
+
+      if (!WhoopCommandLineOptions.Get().WhoopDeclFile.Equals(""))
+      {
+        var rulesFile = Path.Combine(Path.GetDirectoryName(Path.GetFullPath(
+          WhoopCommandLineOptions.Get().WhoopDeclFile)), "kernel_rules.info");
+        if (File.Exists(rulesFile))
+          return rulesFile;
+      }
+
+      return Path.Combine(Path.GetDirectoryName(typeof(KernelRules).Assembly.Location),
+        "..", "Model", "kernel_rules.info");
+    }
+
+    private static int GetApiId(string api)
+    {
+      int id = -1;
+      if (!KernelRules.ApiIds.TryGetValue(api, out id))
+        return -1;
+      return id;
+    }
+
+    private static int InternApi(string api)
+    {
+      int id = KernelRules.GetApiId(api);
+      if (id >= 0)
+        return id;
+
+      id = KernelRules.ApiIds.Count;
+      KernelRules.ApiIds.Add(api, id);
+      KernelRules.ClassMasks.Add(0);
+      KernelRules.GlobalLockMasks.Add(0);
+      return id;
+    }
+
+    private static List<int> ParseApis(string apis)
+    {
+      var ids = new List<int>();
+
+      foreach (var api in apis.Split(',').Select(val => val.Trim()).Where(val => !val.Equals("")))
+      {
+        if (!api.StartsWith("@"))
+        {
+          ids.Add(KernelRules.InternApi(api));
+          continue;
+        }
+
+        List<int> named = null;
+        if (!KernelRules.NamedApis.TryGetValue(api.Substring(1), out named))
+          KernelRules.Fail("Cannot find the kernel rule " + api.Substring(1) + ".");
+        ids.AddRange(named);
+      }
+
+      return ids.Distinct().ToList();
+    }
+
+    private static void AddClass(string name, List<int> ids)
+    {
+      if (KernelRules.ClassBits.Count == 64)
+        KernelRules.Fail("Cannot have more than 64 kernel API classes.");
+
+      ulong bit = 1UL << KernelRules.ClassBits.Count;
+      KernelRules.ClassBits[name] = bit;
+      foreach (var id in ids)
+        KernelRules.ClassMasks[id] |= bit;
+      KernelRules.NamedApis[name] = ids;
+    }
+
+    private static void AddLock(string name, string scope, List<int> ids)
+    {
+      if (KernelRules.NextLockBit == 64)
+        KernelRules.Fail("Cannot have more than 64 kernel imposed locks.");
+
+      ulong bit = 1UL << KernelRules.NextLockBit++;
+      if (scope.Equals("*"))
+      {
+        KernelRules.LockBits[name] = bit;
+        foreach (var id in ids)
+          KernelRules.GlobalLockMasks[id] |= bit;
+        KernelRules.NamedApis[name] = ids;
+      }
+      else
+      {
+        KernelRules.AddScopedMask(KernelRules.ScopedLockMasks, scope, ids, bit);
+      }
+    }
+
+    private static void AddExclusive(string scope, List<int> ids)
+    {
+      if (KernelRules.NextExclusiveBit == 64)
+        KernelRules.Fail("Cannot have more than 64 exclusive kernel rules.");
+
+      ulong bit = 1UL << KernelRules.NextExclusiveBit++;
+      KernelRules.AddScopedMask(KernelRules.ExclusiveMasks, scope, ids, bit);
+      KernelRules.ScopeMasks[scope] = KernelRules.GetScopeMask(scope) | bit;
+    }
+
+    private static void AddScopedMask(Dictionary<string, Dictionary<int, ulong>> masks,
+      string scope, List<int> ids, ulong bit)
+    {
+      if (!masks.ContainsKey(scope))
+        masks.Add(scope, new Dictionary<int, ulong>());
+      foreach (var id in ids)
+        masks[scope][id] = KernelRules.GetScopedMask(masks, scope, id) | bit;
+    }
+
+    private static ulong GetScopedMask(Dictionary<string, Dictionary<int, ulong>> masks,
+      string scope, int id)
+    {
+      Dictionary<int, ulong> scoped = null;
+      ulong mask = 0;
+      if (masks.TryGetValue(scope, out scoped))
+        scoped.TryGetValue(id, out mask);
+      return mask;
+    }
+
+    private static void Fail(string message)
+    {
+      throw new OutcomeException(Outcome.ParsingError, message);
+    }
+
+    #endregion
+  }
+}
@@ -13,6 +13,7 @@ using System;
 using System.Collections.Generic;
 using System.Diagnostics.Contracts;
 using System.IO;
+using System.Linq;
 using Microsoft.Boogie;
 
 namespace Whoop.IO
@@ -22,7 +23,7 @@ namespace Whoop.IO
   /// </summary>
   public static class BoogieProgramEmitter
   {
-    public static void Emit(List<Declaration> declarations, string file, string extension = "bpl")
+    public static void Emit(IEnumerable<Declaration> declarations, string file, string extension = "bpl")
     {
       string directoryContainingFile = Path.GetDirectoryName(file);
       if (string.IsNullOrEmpty(directoryContainingFile))
@@ -33,11 +34,11 @@ namespace Whoop.IO
 
       using(TokenTextWriter writer = new TokenTextWriter(fileName + "." + extension, true))
       {
-        declarations.Emit(writer);
+        declarations.ToList().Emit(writer);
       }
     }
 
-    public static void Emit(List<Declaration> declarations, string file, string suffix, string extension = "bpl")
+    public static void Emit(IEnumerable<Declaration> declarations, string file, string suffix, string extension = "bpl")
     {
       string directoryContainingFile = Path.GetDirectoryName(file);
       if (string.IsNullOrEmpty(directoryContainingFile))
@@ -48,7 +49,7 @@ namespace Whoop.IO
 
       using(TokenTextWriter writer = new TokenTextWriter(fileName + "." + extension, true))
       {
-        declarations.Emit(writer);
+        declarations.ToList().Emit(writer);
       }
     }
   }
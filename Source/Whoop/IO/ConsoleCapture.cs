@@ -0,0 +1,160 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+namespace Whoop.IO
+{
+  /// <summary>
+  /// Redirects console output of the calling thread into a private buffer. This
+  /// allows concurrently running tasks to be replayed in a deterministic order.
+  /// </summary>
+  public static class ConsoleCapture
+  {
+    private static CapturingTextWriter Out;
+    private static CapturingTextWriter Error;
+    private static TextWriter InstalledOut;
+    private static TextWriter InstalledError;
+
+    /// <summary>
+    /// Installs the capturing writers on top of the standard console streams. The
+    /// writers are installed again if the console streams have been replaced.
+    /// </summary>
+    public static void Install()
+    {
+      if (ConsoleCapture.Out != null && Console.Out == ConsoleCapture.InstalledOut &&
+          Console.Error == ConsoleCapture.InstalledError)
+        return;
+
+      ConsoleCapture.Out = new CapturingTextWriter(Console.Out);
+      ConsoleCapture.Error = new CapturingTextWriter(Console.Error);
+
+      Console.SetOut(ConsoleCapture.Out);
+      Console.SetError(ConsoleCapture.Error);
+
+      // The console wraps the writers, so remember what it actually installed
+      ConsoleCapture.InstalledOut = Console.Out;
+      ConsoleCapture.InstalledError = Console.Error;
+    }
+
+    /// <summary>
+    /// Starts capturing the console output of the calling thread. Captures can be
+    /// nested, in which case the output of the inner capture is kept from the
+    /// enclosing one until it is replayed.
+    /// </summary>
+    public static void Begin()
+    {
+      Contract.Requires(ConsoleCapture.Out != null);
+      ConsoleCapture.Out.Begin();
+      ConsoleCapture.Error.Begin();
+    }
+
+    /// <summary>
+    /// Stops capturing the console output of the calling thread.
+    /// </summary>
+    /// <returns>Captured standard output and error</returns>
+    public static Tuple<string, string> End()
+    {
+      Contract.Requires(ConsoleCapture.Out != null);
+      return new Tuple<string, string>(ConsoleCapture.Out.End(), ConsoleCapture.Error.End());
+    }
+
+    /// <summary>
+    /// Writes previously captured output to the console.
+    /// </summary>
+    /// <param name="output">Captured standard output and error</param>
+    public static void Replay(Tuple<string, string> output)
+    {
+      Contract.Requires(output != null);
+      Console.Out.Write(output.Item1);
+      Console.Out.Flush();
+      Console.Error.Write(output.Item2);
+      Console.Error.Flush();
+    }
+
+    private sealed class CapturingTextWriter : TextWriter
+    {
+      private TextWriter Underlying;
+      private ThreadLocal<StringWriter> Buffer;
+      private ThreadLocal<Stack<StringWriter>> Enclosing;
+
+      public CapturingTextWriter(TextWriter underlying)
+      {
+        this.Underlying = underlying;
+        this.Buffer = new ThreadLocal<StringWriter>();
+        this.Enclosing = new ThreadLocal<Stack<StringWriter>>(() => new Stack<StringWriter>());
+      }
+
+      public override Encoding Encoding
+      {
+        get { return this.Underlying.Encoding; }
+      }
+
+      public void Begin()
+      {
+        if (this.Buffer.Value != null)
+          this.Enclosing.Value.Push(this.Buffer.Value);
+        this.Buffer.Value = new StringWriter();
+      }
+
+      public string End()
+      {
+        var buffer = this.Buffer.Value;
+        this.Buffer.Value = this.Enclosing.Value.Count > 0 ? this.Enclosing.Value.Pop() : null;
+
+        return buffer == null ? "" : buffer.ToString();
+      }
+
+      private TextWriter Target()
+      {
+        var buffer = this.Buffer.Value;
+        if (buffer != null)
+          return buffer;
+        return this.Underlying;
+      }
+
+      public override void Write(char value)
+      {
+        this.Target().Write(value);
+      }
+
+      public override void Write(char[] buffer, int index, int count)
+      {
+        this.Target().Write(buffer, index, count);
+      }
+
+      public override void Write(string value)
+      {
+        this.Target().Write(value);
+      }
+
+      public override void WriteLine()
+      {
+        this.Target().WriteLine();
+      }
+
+      public override void WriteLine(string value)
+      {
+        this.Target().WriteLine(value);
+      }
+
+      public override void Flush()
+      {
+        this.Target().Flush();
+      }
+    }
+  }
+}
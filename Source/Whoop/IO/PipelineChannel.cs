@@ -0,0 +1,160 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+namespace Whoop.IO
+{
+  /// <summary>
+  /// Lets a tool announce the artifacts that it has finished writing, so that the
+  /// tools further down the pipeline can start working on them while it is still
+  /// running. Each tool announces into its own "driver.tool.pipeline.info" file,
+  /// one artifact per line, and closes the file with "&lt;/&gt;" when it is done.
+  /// </summary>
+  public sealed class PipelineChannel
+  {
+    #region fields
+
+    private static readonly string EndOfChannel = "</>";
+    public static readonly int PollingInterval = 100;
+
+    private string FileName;
+    private long Position;
+    private object AnnounceLock;
+
+    /// <summary>
+    /// True once the tool has closed the channel, and all of its announcements
+    /// have been received.
+    /// </summary>
+    public bool IsClosed { get; private set; }
+
+    #endregion
+
+    #region public API
+
+    /// <summary>
+    /// Opens the channel of the given tool.
+    /// </summary>
+    /// <param name="files">List of file names</param>
+    /// <param name="tool">Tool name</param>
+    public PipelineChannel(List<string> files, string tool)
+    {
+      Contract.Requires(files != null && tool != null);
+      this.FileName = files[files.Count - 1].Substring(0,
+        files[files.Count - 1].LastIndexOf(".")) + "." + tool + ".pipeline.info";
+      this.Position = 0;
+      this.IsClosed = false;
+      this.AnnounceLock = new object();
+    }
+
+    /// <summary>
+    /// Starts a new channel, dropping anything announced by a previous run.
+    /// </summary>
+    public void Create()
+    {
+      File.WriteAllText(this.FileName, "");
+    }
+
+    /// <summary>
+    /// Announces that the given artifact is ready.
+    /// </summary>
+    /// <param name="artifact">Artifact</param>
+    public void Announce(string artifact)
+    {
+      Contract.Requires(artifact != null && !artifact.Contains("\n"));
+      lock (this.AnnounceLock)
+      {
+        File.AppendAllText(this.FileName, artifact + "\n");
+      }
+    }
+
+    /// <summary>
+    /// Announces that the tool has finished, and that no more artifacts follow.
+    /// </summary>
+    public void Close()
+    {
+      this.Announce(PipelineChannel.EndOfChannel);
+    }
+
+    /// <summary>
+    /// Waits until new artifacts are announced, or until the channel is closed.
+    /// </summary>
+    /// <returns>The newly announced artifacts, or null if the channel is closed</returns>
+    public List<string> Receive()
+    {
+      while (!this.IsClosed)
+      {
+        var artifacts = this.Poll();
+        if (artifacts.Count > 0 || this.IsClosed)
+          return artifacts.Count > 0 ? artifacts : null;
+        Thread.Sleep(PipelineChannel.PollingInterval);
+      }
+
+      return null;
+    }
+
+    /// <summary>
+    /// Returns the artifacts that were announced since the last call, without
+    /// waiting for new ones.
+    /// </summary>
+    /// <returns>The newly announced artifacts</returns>
+    public List<string> Poll()
+    {
+      var artifacts = new List<string>();
+      if (!File.Exists(this.FileName))
+        return artifacts;
+
+      using (var stream = new FileStream(this.FileName, FileMode.Open, FileAccess.Read, FileShare.ReadWrite))
+      {
+        if (stream.Length <= this.Position)
+          return artifacts;
+
+        var buffer = new byte[stream.Length - this.Position];
+        stream.Seek(this.Position, SeekOrigin.Begin);
+
+        int count = 0;
+        while (count < buffer.Length)
+        {
+          int read = stream.Read(buffer, count, buffer.Length - count);
+          if (read == 0)
+            break;
+          count += read;
+        }
+
+        // A line that is still being written is picked up by the next poll
+        int end = count > 0 ? Array.LastIndexOf(buffer, (byte)'\n', count - 1) : -1;
+        if (end < 0)
+          return artifacts;
+        this.Position += end + 1;
+
+        foreach (var line in Encoding.UTF8.GetString(buffer, 0, end).Split('\n'))
+        {
+          if (line.Equals(PipelineChannel.EndOfChannel))
+          {
+            this.IsClosed = true;
+            break;
+          }
+
+          artifacts.Add(line);
+        }
+      }
+
+      return artifacts;
+    }
+
+    #endregion
+  }
+}
@@ -91,7 +91,8 @@ namespace Whoop.IO
       else
       {
         Console.Write("{0} finished with {1} (out of {2}) entry point pairs verified, {3} error{4}",
-          CommandLineOptions.Clo.DescriptiveToolName, stats.VerifiedCount, DeviceDriver.EntryPointPairs.Count,
+          CommandLineOptions.Clo.DescriptiveToolName, stats.VerifiedCount,
+          DeviceDriver.EntryPointPairs.Count + DeviceDriver.PrunedEntryPointPairs.Count,
           stats.ErrorCount, stats.ErrorCount == 1 ? "" : "s");
       }
 
@@ -49,8 +49,20 @@ namespace Whoop.Instrumentation
         this.Timer.Start();
       }
 
-      this.AddCurrentLocksets();
-      this.AddMemoryLocksets();
+      if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+      {
+        // The global locks that other entry points have discovered are declared
+        // too, so the locksets of all entry points have the same width
+        this.AddGlobalLocks();
+        this.AddBitvectorCurrentLockset();
+        this.AddBitvectorMemoryLocksets();
+      }
+      else
+      {
+        this.AddCurrentLocksets();
+        this.AddMemoryLocksets();
+      }
+
       this.AddAccessCheckingVariables();
       this.AddAccessWatchdogConstants();
 
@@ -90,6 +102,54 @@ namespace Whoop.Instrumentation
       }
     }
 
+    private void AddGlobalLocks()
+    {
+      foreach (var l in AnalysisSession.Current.GetGlobalLocks())
+      {
+        if (this.AC.GetConstant(l.Id.Name) != null)
+          continue;
+        this.AC.TopLevelDeclarations.Add(l.Id);
+        this.AC.Locks.Add(l);
+      }
+    }
+
+    private void AddBitvectorCurrentLockset()
+    {
+      var locks = BitvectorLocksets.GetLocks(this.AC);
+      if (locks.Count == 0)
+        return;
+
+      BitvectorLocksets.AddFunctions(this.AC, locks.Count);
+
+      var ls = new GlobalVariable(Token.NoToken,
+        new TypedIdent(Token.NoToken, "locks_in_CLS_$" + this.EP.Name,
+          new BvType(locks.Count)));
+      ls.AddAttribute("current_lockset", new object[] { });
+      this.AC.TopLevelDeclarations.Add(ls);
+
+      for (int bit = 0; bit < locks.Count; bit++)
+        this.AC.CurrentLocksets.Add(new Lockset(ls, locks[bit], this.EP, "", bit));
+    }
+
+    private void AddBitvectorMemoryLocksets()
+    {
+      var locks = BitvectorLocksets.GetLocks(this.AC);
+      if (locks.Count == 0)
+        return;
+
+      foreach (var mr in this.MemoryRegions)
+      {
+        var ls = new GlobalVariable(Token.NoToken,
+          new TypedIdent(Token.NoToken, "locks_in_LS_" + mr.Name +
+            "_$" + this.EP.Name, new BvType(locks.Count)));
+        ls.AddAttribute("lockset", new object[] { });
+        this.AC.TopLevelDeclarations.Add(ls);
+
+        for (int bit = 0; bit < locks.Count; bit++)
+          this.AC.MemoryLocksets.Add(new Lockset(ls, locks[bit], this.EP, mr.Name, bit));
+      }
+    }
+
     private void AddAccessCheckingVariables()
     {
       for (int i = 0; i < this.MemoryRegions.Count; i++)
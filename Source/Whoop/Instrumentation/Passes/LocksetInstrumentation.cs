@@ -106,6 +106,8 @@ namespace Whoop.Instrumentation
       {
         if (this.ShouldSkipLockset(ls))
           continue;
+        if (proc.Modifies.Any(val => val.Name.Equals(ls.Id.Name)))
+          continue;
 
         proc.Modifies.Add(new IdentifierExpr(ls.Id.tok, ls.Id));
       }
@@ -115,8 +117,13 @@ namespace Whoop.Instrumentation
 
       Block b = new Block(Token.NoToken, "_UPDATE", new List<Cmd>(), new ReturnCmd(Token.NoToken));
 
+      if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+        this.AddBitvectorLocksetUpdate(b, in1, in2);
+
       foreach (var ls in this.AC.CurrentLocksets)
       {
+        if (ls.Bit >= 0)
+          continue;
         if (this.ShouldSkipLockset(ls))
           continue;
 
@@ -159,6 +166,46 @@ namespace Whoop.Instrumentation
       this.AC.TopLevelDeclarations.Add(impl);
     }
 
+    /// <summary>
+    /// Adds the update of the bitvector current lockset, which sets or clears the bit
+    /// of the given lock in a single assignment. Locks that the entry point does not
+    /// use have no bit in the mask, so their bits are left unchanged.
+    /// </summary>
+    /// <param name="b">Block of the update function</param>
+    /// <param name="l">Lock parameter</param>
+    /// <param name="isLocked">Locked parameter</param>
+    private void AddBitvectorLocksetUpdate(Block b, Variable l, Variable isLocked)
+    {
+      var locksets = this.AC.CurrentLocksets.FindAll(val => !this.ShouldSkipLockset(val));
+      if (locksets.Count == 0)
+        return;
+
+      var cls = locksets[0].Id;
+      int width = BitvectorLocksets.GetWidth(cls);
+      var clsExpr = new IdentifierExpr(cls.tok, cls);
+
+      Expr mask = BitvectorLocksets.CreateMask(width, new List<int>());
+      foreach (var ls in locksets)
+      {
+        mask = new NAryExpr(Token.NoToken, new IfThenElse(Token.NoToken),
+          new List<Expr>(new Expr[] { Expr.Eq(new IdentifierExpr(l.tok, l),
+              new IdentifierExpr(ls.Lock.tok, ls.Lock)),
+            BitvectorLocksets.CreateMask(width, new List<int> { ls.Bit }), mask
+          }));
+      }
+
+      var update = new NAryExpr(Token.NoToken, new IfThenElse(Token.NoToken),
+        new List<Expr>(new Expr[] { new IdentifierExpr(isLocked.tok, isLocked),
+          BitvectorLocksets.Or(this.AC, width, clsExpr, mask),
+          BitvectorLocksets.And(this.AC, width, clsExpr,
+            BitvectorLocksets.Not(this.AC, width, mask))
+        }));
+
+      b.Cmds.Add(new AssignCmd(Token.NoToken,
+        new List<AssignLhs> { new SimpleAssignLhs(cls.tok, new IdentifierExpr(cls.tok, cls)) },
+        new List<Expr> { update }));
+    }
+
     private void AddNonCheckedFunc()
     {
       Procedure proc = new Procedure(Token.NoToken, "_NO_OP_$" + this.EP.Name,
@@ -310,6 +357,8 @@ namespace Whoop.Instrumentation
       {
         if (this.ShouldSkipLockset(ls))
           continue;
+        if (region.Procedure().Modifies.Any(val => val.Name.Equals(ls.Id.Name)))
+          continue;
 
         region.Procedure().Modifies.Add(new IdentifierExpr(ls.Id.tok, ls.Id));
       }
@@ -322,9 +371,41 @@ namespace Whoop.Instrumentation
           continue;
         if (this.ShouldSkipLockset(ls))
           continue;
+        if (region.Procedure().Modifies.Any(val => val.Name.Equals(ls.Id.Name)))
+          continue;
 
         region.Procedure().Modifies.Add(new IdentifierExpr(ls.Id.tok, ls.Id));
       }
+
+      if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+        this.InstrumentBitvectorFrame(region);
+    }
+
+    /// <summary>
+    /// A bitvector lockset is modified as a whole, even though the bits of the locks
+    /// that the entry point does not use never change. These bits are kept by a free
+    /// postcondition of the procedure and a free invariant of each of its loops, just
+    /// as a boolean lockset that is not modified keeps its value.
+    /// </summary>
+    /// <param name="region">Instrumentation region</param>
+    private void InstrumentBitvectorFrame(InstrumentationRegion region)
+    {
+      var locksets = this.AC.CurrentLocksets.Concat(this.AC.MemoryLocksets).ToList();
+
+      foreach (var ls in region.Procedure().Modifies.ToList())
+      {
+        var skipped = locksets.FindAll(val => val.Bit >= 0 &&
+          val.Id.Name.Equals(ls.Name) && this.ShouldSkipLockset(val));
+        if (skipped.Count == 0)
+          continue;
+
+        var bits = skipped.Select(val => val.Bit).ToList();
+        region.Procedure().Ensures.Add(new Ensures(true,
+          BitvectorLocksets.CreateFrameExpr(this.AC, skipped[0].Id, bits)));
+        foreach (var block in region.LoopHeaders())
+          block.Cmds.Insert(0, new AssumeCmd(Token.NoToken,
+            BitvectorLocksets.CreateFrameExpr(this.AC, skipped[0].Id, bits)));
+      }
     }
 
     private void InstrumentEntryPointProcedure()
@@ -332,8 +413,16 @@ namespace Whoop.Instrumentation
       var region = this.AC.InstrumentationRegions.Find(val =>
         val.Name().Equals(this.EP.Name + "$instrumented"));
 
+      if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+      {
+        this.InstrumentBitvectorRequires(region, this.AC.CurrentLocksets, false);
+        this.InstrumentBitvectorRequires(region, this.AC.MemoryLocksets, true);
+      }
+
       foreach (var ls in this.AC.CurrentLocksets)
       {
+        if (ls.Bit >= 0)
+          continue;
         if (this.ShouldSkipLockset(ls))
           continue;
 
@@ -343,6 +432,8 @@ namespace Whoop.Instrumentation
 
       foreach (var ls in this.AC.MemoryLocksets)
       {
+        if (ls.Bit >= 0)
+          continue;
         if (this.ShouldSkipLockset(ls))
           continue;
 
@@ -363,6 +454,16 @@ namespace Whoop.Instrumentation
       }
     }
 
+    private void InstrumentBitvectorRequires(InstrumentationRegion region, List<Lockset> locksets, bool value)
+    {
+      foreach (var ls in locksets.Where(val => !this.ShouldSkipLockset(val)).GroupBy(val => val.Id))
+      {
+        var require = new Requires(false, BitvectorLocksets.CreateMaskedEq(this.AC, ls.Key,
+          ls.Select(val => val.Bit).ToList(), value));
+        region.Procedure().Requires.Add(require);
+      }
+    }
+
     #endregion
 
     #region helper functions
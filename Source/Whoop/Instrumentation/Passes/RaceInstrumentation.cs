@@ -89,8 +89,13 @@ namespace Whoop.Instrumentation
 
         var cmds = new List<Cmd>();
 
+        if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+          this.AddBitvectorLocksetUpdate(proc, cmds, mr);
+
         foreach (var ls in this.AC.MemoryLocksets)
         {
+          if (ls.Bit >= 0)
+            continue;
           if (!ls.TargetName.Equals(mr.Name))
             continue;
           if (this.ShouldSkipLockset(ls))
@@ -194,6 +199,41 @@ namespace Whoop.Instrumentation
       }
     }
 
+    /// <summary>
+    /// Intersects the bitvector lockset of the given memory region with the current
+    /// lockset. The bits of the locks that the entry point does not use are kept.
+    /// </summary>
+    /// <param name="proc">Access procedure</param>
+    /// <param name="cmds">Commands of the access procedure</param>
+    /// <param name="mr">Memory region</param>
+    private void AddBitvectorLocksetUpdate(Procedure proc, List<Cmd> cmds, Variable mr)
+    {
+      var locksets = this.AC.MemoryLocksets.FindAll(val => val.TargetName.Equals(mr.Name));
+      if (locksets.Count == 0 || locksets.All(val => this.ShouldSkipLockset(val)))
+        return;
+
+      var ls = locksets[0].Id;
+      var cls = this.AC.CurrentLocksets[0].Id;
+      int width = BitvectorLocksets.GetWidth(ls);
+
+      Expr clsExpr = new IdentifierExpr(cls.tok, cls);
+      var skipped = locksets.FindAll(val => this.ShouldSkipLockset(val));
+      if (skipped.Count > 0)
+        clsExpr = BitvectorLocksets.Or(this.AC, width, clsExpr,
+          BitvectorLocksets.CreateMask(width, skipped.Select(val => val.Bit)));
+
+      IdentifierExpr lsExpr = new IdentifierExpr(ls.tok, ls);
+
+      cmds.Add(new AssignCmd(Token.NoToken,
+        new List<AssignLhs>() {
+        new SimpleAssignLhs(Token.NoToken, lsExpr)
+      }, new List<Expr> {
+        BitvectorLocksets.And(this.AC, width, lsExpr, clsExpr)
+      }));
+
+      proc.Modifies.Add(lsExpr);
+    }
+
     #endregion
 
     #region race checking instrumentation
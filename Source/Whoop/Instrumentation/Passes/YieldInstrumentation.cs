@@ -44,6 +44,11 @@ namespace Whoop.Instrumentation
       this.ErrorReporter = errorReporter;
     }
 
+    internal static void ResetYieldCounter()
+    {
+      YieldInstrumentation.YieldCounter = 0;
+    }
+
     public void Run()
     {
       if (WhoopCommandLineOptions.Get().MeasurePassExecutionTime)
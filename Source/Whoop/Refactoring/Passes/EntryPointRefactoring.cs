@@ -88,6 +88,8 @@ namespace Whoop.Refactoring
         "entrypoint", new List<object>(), null);
       this.Implementation.Attributes = new QKeyValue(Token.NoToken,
         "entrypoint", new List<object>(), null);
+
+      this.AC.TopLevelDeclarations.InvalidateIndex();
     }
 
     private void RefactorEntryPointResult()
@@ -108,6 +110,8 @@ namespace Whoop.Refactoring
       {
         gv.Name = gv.Name + "$" + this.EP.Name;
       }
+
+      this.AC.TopLevelDeclarations.InvalidateIndex();
     }
 
     private void ParseAndRenameNestedFunctions(Implementation impl)
@@ -267,6 +271,7 @@ namespace Whoop.Refactoring
 
       func.Proc.Name = func.Proc.Name + "$" + this.EP.Name;
       func.Name = func.Name + "$" + this.EP.Name;
+      this.AC.TopLevelDeclarations.InvalidateIndex();
     }
 
     private void AddTag(Implementation func)
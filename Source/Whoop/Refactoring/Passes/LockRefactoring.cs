@@ -84,6 +84,7 @@ namespace Whoop.Refactoring
         return;
       this.AlreadyRefactoredFunctions.Add(impl);
 
+      var index = new DefUseIndex(impl);
       foreach (var block in impl.Blocks)
       {
         foreach (var cmd in block.Cmds)
@@ -135,7 +136,7 @@ namespace Whoop.Refactoring
               call.callee.Contains("spin_unlock") ||
               call.callee.Contains("spin_unlock_irqrestore"))
             {
-              var lockExpr = PointerArithmeticAnalyser.ComputeRootPointer(impl, block.Label, call.Ins[0]);
+              var lockExpr = PointerArithmeticAnalyser.ComputeRootPointer(index, block.Label, call.Ins[0]);
               if (inPtrs != null && (!(lockExpr is LiteralExpr) || (lockExpr is NAryExpr)))
               {
                 if (lockExpr is IdentifierExpr)
@@ -185,7 +186,7 @@ namespace Whoop.Refactoring
                 newLock.Id.AddAttribute("lock", new object[] { });
                 this.AC.TopLevelDeclarations.Add(newLock.Id);
                 this.AC.Locks.Add(newLock);
-                AnalysisContext.GlobalLocks.Add(newLock);
+                AnalysisSession.Current.AddGlobalLock(newLock);
 
                 call.Ins[0] = new IdentifierExpr(newLock.Id.tok, newLock.Id);
                 matched = true;
@@ -212,7 +213,7 @@ namespace Whoop.Refactoring
                 }
                 else
                 {
-                  Expr ptrExpr = PointerArithmeticAnalyser.ComputeRootPointer(impl, block.Label, inParam);
+                  Expr ptrExpr = PointerArithmeticAnalyser.ComputeRootPointer(index, block.Label, inParam);
                   computedRootPointers.Add(ptrExpr);
                 }
               }
@@ -64,6 +64,12 @@ namespace Whoop.Regions
     private Dictionary<string, List<Expr>> NonWatchedResourceAccesses;
     private HashSet<string> ResourcesWithUnidentifiedAccesses;
 
+    private Dictionary<string, HashSet<ExprKey>> ResourceAccessKeys;
+    private Dictionary<string, HashSet<ExprKey>> LocalResourceAccessKeys;
+    private Dictionary<string, HashSet<ExprKey>> ExternalResourceAccessKeys;
+    private Dictionary<string, HashSet<ExprKey>> AxiomResourceAccessKeys;
+    private Dictionary<string, HashSet<ExprKey>> NonWatchedResourceAccessKeys;
+
     internal Dictionary<CallCmd, Dictionary<int, Tuple<Expr, Expr>>> CallInformation;
     internal Dictionary<CallCmd, Dictionary<string, HashSet<Expr>>> ExternallyReceivedAccesses;
     internal HashSet<Variable> FunctionPointers;
@@ -109,6 +115,12 @@ namespace Whoop.Regions
       this.NonWatchedResourceAccesses = new Dictionary<string, List<Expr>>();
       this.ResourcesWithUnidentifiedAccesses = new HashSet<string>();
 
+      this.ResourceAccessKeys = new Dictionary<string, HashSet<ExprKey>>();
+      this.LocalResourceAccessKeys = new Dictionary<string, HashSet<ExprKey>>();
+      this.ExternalResourceAccessKeys = new Dictionary<string, HashSet<ExprKey>>();
+      this.AxiomResourceAccessKeys = new Dictionary<string, HashSet<ExprKey>>();
+      this.NonWatchedResourceAccessKeys = new Dictionary<string, HashSet<ExprKey>>();
+
       this.CallInformation = new Dictionary<CallCmd, Dictionary<int, Tuple<Expr, Expr>>>();
       this.ExternallyReceivedAccesses = new Dictionary<CallCmd, Dictionary<string, HashSet<Expr>>>();
       this.FunctionPointers = new HashSet<Variable>();
@@ -223,29 +235,7 @@ namespace Whoop.Regions
         return false;
       }
 
-      if (!this.ResourceAccesses.ContainsKey(resource))
-      {
-        this.ResourceAccesses.Add(resource, new List<Expr> { access });
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
-      else if (this.ResourceAccesses[resource].Any(val =>
-        val.ToString().Equals(access.ToString())))
-      {
-        return false;
-      }
-      else
-      {
-        this.ResourceAccesses[resource].Add(access);
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
+      return this.TryAddResourceAccess(resource, access, ExprKey.Of(access));
     }
 
     public bool TryAddLocalResourceAccess(string resource, Expr access)
@@ -256,34 +246,14 @@ namespace Whoop.Regions
         return false;
       }
 
-      if (!this.TryAddResourceAccess(resource, access))
+      var key = ExprKey.Of(access);
+      if (!this.TryAddResourceAccess(resource, access, key))
       {
         return false;
       }
 
-      if (!this.LocalResourceAccesses.ContainsKey(resource))
-      {
-        this.LocalResourceAccesses.Add(resource, new List<Expr> { access });
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
-      else if (this.LocalResourceAccesses[resource].Any(val =>
-        val.ToString().Equals(access.ToString())))
-      {
-        return false;
-      }
-      else
-      {
-        this.LocalResourceAccesses[resource].Add(access);
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
+      return this.TryAddAccess(this.LocalResourceAccesses,
+        this.LocalResourceAccessKeys, resource, access, key);
     }
 
     public bool TryAddExternalResourceAccesses(string resource, Expr access)
@@ -294,15 +264,17 @@ namespace Whoop.Regions
         return false;
       }
 
-      if (this.ExternalResourceAccesses.ContainsKey(resource) && access is NAryExpr)
+      var key = ExprKey.Of(access);
+      if (this.ExternalResourceAccesses.ContainsKey(resource) && access is NAryExpr &&
+        (access as NAryExpr).Fun is BinaryOperator)
       {
-        var arg = (access as NAryExpr).Args[0];
+        var arg = ExprKey.Of((access as NAryExpr).Args[0]);
         var fun = (access as NAryExpr).Fun;
 
         int heuristic = 0;
-        foreach (var acs in this.ExternalResourceAccesses[resource])
+        foreach (var acs in this.ExternalResourceAccessKeys[resource])
         {
-          if (acs.ToString().StartsWith(arg.ToString() + " " + fun.FunctionName))
+          if (acs.IsApplicationOf(fun.FunctionName, arg))
             heuristic++;
         }
 
@@ -314,34 +286,13 @@ namespace Whoop.Regions
         }
       }
 
-      if (!this.TryAddResourceAccess(resource, access))
-      {
-        return false;
-      }
-
-      if (!this.ExternalResourceAccesses.ContainsKey(resource))
-      {
-        this.ExternalResourceAccesses.Add(resource, new List<Expr> { access });
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
-      else if (this.ExternalResourceAccesses[resource].Any(val =>
-        val.ToString().Equals(access.ToString())))
+      if (!this.TryAddResourceAccess(resource, access, key))
       {
         return false;
       }
-      else
-      {
-        this.ExternalResourceAccesses[resource].Add(access);
 
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
+      return this.TryAddAccess(this.ExternalResourceAccesses,
+        this.ExternalResourceAccessKeys, resource, access, key);
     }
 
     public bool TryAddAxiomResourceAccesses(string resource, Expr access)
@@ -352,53 +303,29 @@ namespace Whoop.Regions
         return false;
       }
 
-      if (!this.TryAddResourceAccess(resource, access))
+      var key = ExprKey.Of(access);
+      if (!this.TryAddResourceAccess(resource, access, key))
       {
         return false;
       }
 
-      if (!this.AxiomResourceAccesses.ContainsKey(resource))
-      {
-        this.AxiomResourceAccesses.Add(resource, new List<Expr> { access });
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
-      else if (this.AxiomResourceAccesses[resource].Any(val =>
-        val.ToString().Equals(access.ToString())))
-      {
-        return false;
-      }
-      else
-      {
-        this.AxiomResourceAccesses[resource].Add(access);
-
-        if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
-          this.ResourcesWithUnidentifiedAccesses.Remove(resource);
-
-        return true;
-      }
+      return this.TryAddAccess(this.AxiomResourceAccesses,
+        this.AxiomResourceAccessKeys, resource, access, key);
     }
 
     public bool TryAddNonWatchedResourceAccesses(string resource, Expr access)
     {
-      if (!this.NonWatchedResourceAccesses.ContainsKey(resource))
-      {
-        this.NonWatchedResourceAccesses.Add(resource, new List<Expr> { access });
-        return true;
-      }
-      else if (this.NonWatchedResourceAccesses[resource].Any(val =>
-        val.ToString().Equals(access.ToString())))
-      {
+      var key = ExprKey.Of(access);
+      if (!this.NonWatchedResourceAccessKeys.ContainsKey(resource))
+        this.NonWatchedResourceAccessKeys.Add(resource, new HashSet<ExprKey>());
+      if (!this.NonWatchedResourceAccessKeys[resource].Add(key))
         return false;
-      }
-      else
-      {
-        this.NonWatchedResourceAccesses[resource].Add(access);
-        return true;
-      }
+
+      if (!this.NonWatchedResourceAccesses.ContainsKey(resource))
+        this.NonWatchedResourceAccesses.Add(resource, new List<Expr>());
+      this.NonWatchedResourceAccesses[resource].Add(access);
+
+      return true;
     }
 
     public override bool Equals(System.Object obj)
@@ -460,6 +387,30 @@ namespace Whoop.Regions
       return header;
     }
 
+    private bool TryAddResourceAccess(string resource, Expr access, ExprKey key)
+    {
+      return this.TryAddAccess(this.ResourceAccesses,
+        this.ResourceAccessKeys, resource, access, key);
+    }
+
+    private bool TryAddAccess(Dictionary<string, List<Expr>> accesses,
+      Dictionary<string, HashSet<ExprKey>> keys, string resource, Expr access, ExprKey key)
+    {
+      if (!keys.ContainsKey(resource))
+        keys.Add(resource, new HashSet<ExprKey>());
+      if (!keys[resource].Add(key))
+        return false;
+
+      if (!accesses.ContainsKey(resource))
+        accesses.Add(resource, new List<Expr>());
+      accesses[resource].Add(access);
+
+      if (this.ResourcesWithUnidentifiedAccesses.Contains(resource))
+        this.ResourcesWithUnidentifiedAccesses.Remove(resource);
+
+      return true;
+    }
+
     #endregion
   }
 }
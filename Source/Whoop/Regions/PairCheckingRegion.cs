@@ -199,11 +199,12 @@ namespace Whoop.Regions
         larg = access;
       }
 
+      // The in-parameter maps are keyed by name, so only identifiers can match.
       IdentifierExpr id = null;
-      if (ep.Equals(this.EP1) && this.InParamMapEP1.ContainsKey(larg.ToString()))
-        id = this.InParamMapEP1[larg.ToString()];
-      else if (ep.Equals(this.EP2) && this.InParamMapEP2.ContainsKey(larg.ToString()))
-        id = this.InParamMapEP2[larg.ToString()];
+      if (larg is IdentifierExpr && ep.Equals(this.EP1))
+        this.InParamMapEP1.TryGetValue((larg as IdentifierExpr).Name, out id);
+      else if (larg is IdentifierExpr && ep.Equals(this.EP2))
+        this.InParamMapEP2.TryGetValue((larg as IdentifierExpr).Name, out id);
 
       if (id == null)
         matchedAccess = access;
@@ -281,8 +282,13 @@ namespace Whoop.Regions
       List<Variable> varsEp1 = SharedStateAnalyser.GetMemoryRegions(DeviceDriver.GetEntryPoint(impl1.Name));
       List<Variable> varsEp2 = SharedStateAnalyser.GetMemoryRegions(DeviceDriver.GetEntryPoint(impl2.Name));
 
+      if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+        this.CreateBitvectorLocksetRequires();
+
       foreach (var ls in this.AC.CurrentLocksets)
       {
+        if (ls.Bit >= 0)
+          continue;
         var require = new Requires(false, Expr.Not(new IdentifierExpr(ls.Id.tok,
           new Duplicator().Visit(ls.Id.Clone()) as Variable)));
         this.InternalImplementation.Proc.Requires.Add(require);
@@ -290,6 +296,9 @@ namespace Whoop.Regions
 
       foreach (var ls in this.AC.MemoryLocksets)
       {
+        if (ls.Bit >= 0)
+          continue;
+
         Requires require = null;
 
         if (!this.IsLockUsed(ls))
@@ -333,6 +342,8 @@ namespace Whoop.Regions
       {
         if (!this.IsLockUsed(ls))
           continue;
+        if (this.InternalImplementation.Proc.Modifies.Any(val => val.Name.Equals(ls.Id.Name)))
+          continue;
         this.InternalImplementation.Proc.Modifies.Add(new IdentifierExpr(
           ls.Id.tok, new Duplicator().Visit(ls.Id.Clone()) as Variable));
       }
@@ -341,6 +352,8 @@ namespace Whoop.Regions
       {
         if (!this.IsLockUsed(ls))
           continue;
+        if (this.InternalImplementation.Proc.Modifies.Any(val => val.Name.Equals(ls.Id.Name)))
+          continue;
         this.InternalImplementation.Proc.Modifies.Add(new IdentifierExpr(
           ls.Id.tok, new Duplicator().Visit(ls.Id.Clone()) as Variable));
       }
@@ -370,6 +383,30 @@ namespace Whoop.Regions
       }
     }
 
+    /// <summary>
+    /// Each bitvector current lockset starts empty, and each bitvector memory lockset
+    /// starts with the bits of the locks that are used by its entry point.
+    /// </summary>
+    private void CreateBitvectorLocksetRequires()
+    {
+      foreach (var ls in this.AC.CurrentLocksets.GroupBy(val => val.Id))
+      {
+        var require = new Requires(false, Expr.Eq(new IdentifierExpr(ls.Key.tok,
+          new Duplicator().Visit(ls.Key.Clone()) as Variable),
+          BitvectorLocksets.CreateMask(BitvectorLocksets.GetWidth(ls.Key), new List<int>())));
+        this.InternalImplementation.Proc.Requires.Add(require);
+      }
+
+      foreach (var ls in this.AC.MemoryLocksets.GroupBy(val => val.Id))
+      {
+        var bits = ls.Where(val => this.IsLockUsed(val)).Select(val => val.Bit);
+        var require = new Requires(false, Expr.Eq(new IdentifierExpr(ls.Key.tok,
+          new Duplicator().Visit(ls.Key.Clone()) as Variable),
+          BitvectorLocksets.CreateMask(BitvectorLocksets.GetWidth(ls.Key), bits)));
+        this.InternalImplementation.Proc.Requires.Add(require);
+      }
+    }
+
     private void CreateInParamCache(Implementation impl1, Implementation impl2)
     {
       for (int idx = 0; idx < this.CC1.Ins.Count; idx++)
@@ -536,6 +573,7 @@ namespace Whoop.Regions
 
       Expr checkExpr = null;
       int lockCounter = 0;
+      var bits = new List<int>();
       foreach (var l in this.AC.Locks)
       {
         if (!this.AC1.Locks.Any(v => v.Name.Equals(l.Name)) &&
@@ -549,6 +587,13 @@ namespace Whoop.Regions
         var ls2  = this.AC.MemoryLocksets.Find(val => val.Lock.Name.Equals(l.Name) &&
           val.TargetName.Equals(mr.Name) && val.EntryPoint.Name.Equals(impl2.Name));
 
+        if (ls1.Bit >= 0)
+        {
+          bits.Add(ls1.Bit);
+          lockCounter++;
+          continue;
+        }
+
         IdentifierExpr lsExpr1 = new IdentifierExpr(ls1.Id.tok, ls1.Id);
         IdentifierExpr lsExpr2 = new IdentifierExpr(ls2.Id.tok, ls2.Id);
 
@@ -578,6 +623,10 @@ namespace Whoop.Regions
       {
         checkExpr = Expr.False;
       }
+      else if (bits.Count > 0)
+      {
+        checkExpr = this.CreateBitvectorLocksetCheck(impl1, impl2, mr, bits);
+      }
 
       Expr acsImpExpr = Expr.Imp(accessesExpr, checkExpr);
 
@@ -590,6 +639,36 @@ namespace Whoop.Regions
       return assert;
     }
 
+    /// <summary>
+    /// Creates the check that the bitvector locksets of the given memory region have
+    /// one of the given bits in common, which intersects them in a single operation.
+    /// </summary>
+    /// <returns>Expression</returns>
+    /// <param name="impl1">First entry point</param>
+    /// <param name="impl2">Second entry point</param>
+    /// <param name="mr">Memory region</param>
+    /// <param name="bits">Bits of the locks that are checked</param>
+    private Expr CreateBitvectorLocksetCheck(Implementation impl1, Implementation impl2,
+      Variable mr, List<int> bits)
+    {
+      var ls1 = this.AC.MemoryLocksets.Find(val => val.TargetName.Equals(mr.Name) &&
+        val.EntryPoint.Name.Equals(impl1.Name)).Id;
+      var ls2 = this.AC.MemoryLocksets.Find(val => val.TargetName.Equals(mr.Name) &&
+        val.EntryPoint.Name.Equals(impl2.Name)).Id;
+      int width = BitvectorLocksets.GetWidth(ls1);
+
+      Expr lsAndExpr = new IdentifierExpr(ls1.tok, ls1);
+      if (!this.EP1.Name.Equals(this.EP2.Name))
+      {
+        lsAndExpr = BitvectorLocksets.And(this.AC, width, lsAndExpr,
+          new IdentifierExpr(ls2.tok, ls2));
+      }
+
+      return Expr.Neq(BitvectorLocksets.And(this.AC, width, lsAndExpr,
+        BitvectorLocksets.CreateMask(width, bits)),
+        BitvectorLocksets.CreateMask(width, new List<int>()));
+    }
+
     private AssumeCmd CreateCaptureStateAssume(Variable mr)
     {
       AssumeCmd assume = new AssumeCmd(Token.NoToken, Expr.True);
@@ -605,6 +684,7 @@ namespace Whoop.Regions
     private void CreateInParamMatcher(Implementation impl1, Implementation impl2)
     {
       var initFunc = this.AC.Checker;
+      var index = new DefUseIndex(initFunc);
       List<Expr> insEp1 = new List<Expr>();
       List<Expr> insEp2 = new List<Expr>();
 
@@ -630,7 +710,7 @@ namespace Whoop.Regions
           {
             foreach (var inParam in call.Ins)
             {
-              Expr resolved = PointerArithmeticAnalyser.GetPointerArithmeticExpr(initFunc, inParam);
+              Expr resolved = PointerArithmeticAnalyser.GetPointerArithmeticExpr(index, inParam);
 
               if (resolved == null)
                 insEp1.Add(inParam);
@@ -643,7 +723,7 @@ namespace Whoop.Regions
           {
             foreach (var inParam in call.Ins)
             {
-              Expr resolved = PointerArithmeticAnalyser.GetPointerArithmeticExpr(initFunc, inParam);
+              Expr resolved = PointerArithmeticAnalyser.GetPointerArithmeticExpr(index, inParam);
 
               if (resolved == null)
                 insEp2.Add(inParam);
@@ -654,11 +734,13 @@ namespace Whoop.Regions
         }
       }
 
+      var keysEp1 = insEp1.Select(val => ExprKey.Of(val)).ToList();
       for (int i = 0; i < insEp2.Count; i++)
       {
-        for (int j = 0; j < insEp1.Count; j++)
+        var key = ExprKey.Of(insEp2[i]);
+        for (int j = 0; j < keysEp1.Count; j++)
         {
-          if (insEp2[i].ToString().Equals(insEp1[j].ToString()))
+          if (key == keysEp1[j])
           {
             if (this.InParamMatcher.ContainsKey(i))
               continue;
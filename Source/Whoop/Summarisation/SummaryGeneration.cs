@@ -36,6 +36,7 @@ namespace Whoop.Summarisation
     protected List<Variable> ReadAccessCheckingVariables;
     protected List<Variable> AccessWatchdogConstants;
     protected List<Variable> DomainSpecificVariables;
+    private Dictionary<Variable, Lockset> BitvectorLocksetViews;
 
     protected HashSet<Constant> ExistentialBooleans;
     private Dictionary<Variable, Dictionary<string, Constant>> TrueExistentialBooleansDict;
@@ -54,8 +55,14 @@ namespace Whoop.Summarisation
       this.AccessWatchdogConstants = this.AC.GetAccessWatchdogConstants();
       this.DomainSpecificVariables = this.AC.GetDomainSpecificVariables();
 
+      this.BitvectorLocksetViews = new Dictionary<Variable, Lockset>();
+      if (WhoopCommandLineOptions.Get().BitvectorLocksets)
+        this.CreateBitvectorLocksetViews();
+
       this.CurrentLocksetVariables = new List<Variable>();
-      foreach (var ls in this.AC.GetCurrentLocksetVariables())
+      foreach (var ls in this.BitvectorLocksetViews.Count == 0 ?
+        this.AC.GetCurrentLocksetVariables() : this.BitvectorLocksetViews.Keys.Where(val =>
+          val.Name.Contains("_in_CLS_$")))
       {
         if (ls.Name.StartsWith("lock$power") && !this.EP.IsCallingPowerLock)
           continue;
@@ -68,7 +75,9 @@ namespace Whoop.Summarisation
       }
 
       this.MemoryLocksetVariables = new List<Variable>();
-      foreach (var ls in this.AC.GetMemoryLocksetVariables())
+      foreach (var ls in this.BitvectorLocksetViews.Count == 0 ?
+        this.AC.GetMemoryLocksetVariables() : this.BitvectorLocksetViews.Keys.Where(val =>
+          val.Name.Contains("_in_LS_")))
       {
         if (ls.Name.StartsWith("lock$power") && !this.EP.IsCallingPowerLock)
           continue;
@@ -401,12 +410,41 @@ namespace Whoop.Summarisation
 
     private Expr CreateExpr(Variable v, bool value)
     {
+      Lockset ls = null;
+      if (this.BitvectorLocksetViews.TryGetValue(v, out ls))
+      {
+        if (value) return BitvectorLocksets.CreateBitExpr(ls);
+        else return Expr.Not(BitvectorLocksets.CreateBitExpr(ls));
+      }
+
       Expr expr = null;
       if (value) expr = new IdentifierExpr(v.tok, v);
       else expr = Expr.Not(new IdentifierExpr(v.tok, v));
       return expr;
     }
 
+    /// <summary>
+    /// A bitvector lockset holds the locks of many boolean locksets, so each of its
+    /// bits gets a view that is named after the boolean lockset that it replaces.
+    /// The candidates on a view are predicates on its bit, so the summaries have the
+    /// same candidates in both encodings.
+    /// </summary>
+    private void CreateBitvectorLocksetViews()
+    {
+      foreach (var ls in this.AC.CurrentLocksets.Where(val => val.Bit >= 0))
+      {
+        this.BitvectorLocksetViews.Add(new LocalVariable(Token.NoToken, new TypedIdent(Token.NoToken,
+          ls.Lock.Name + "_in_CLS_$" + ls.EntryPoint.Name, Microsoft.Boogie.Type.Bool)), ls);
+      }
+
+      foreach (var ls in this.AC.MemoryLocksets.Where(val => val.Bit >= 0))
+      {
+        this.BitvectorLocksetViews.Add(new LocalVariable(Token.NoToken, new TypedIdent(Token.NoToken,
+          ls.Lock.Name + "_in_LS_" + ls.TargetName + "_$" + ls.EntryPoint.Name,
+          Microsoft.Boogie.Type.Bool)), ls);
+      }
+    }
+
     #endregion
   }
 }
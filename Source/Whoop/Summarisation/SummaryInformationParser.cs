@@ -17,6 +17,7 @@ using System.IO;
 
 using Microsoft.Boogie;
 using Microsoft.Basetypes;
+using Whoop.Domain.Drivers;
 
 using Whoop.IO;
 
@@ -27,6 +28,7 @@ namespace Whoop.Summarisation
     #region fields
 
     public static List<string> AvailableSummaries;
+    private static object SummaryLock = new object();
 
     #endregion
 
@@ -34,9 +36,12 @@ namespace Whoop.Summarisation
 
     public static void RegisterSummaryName(string name)
     {
-      if (SummaryInformationParser.AvailableSummaries == null)
-        SummaryInformationParser.AvailableSummaries = new List<string>();
-      SummaryInformationParser.AvailableSummaries.Add(name);
+      lock (SummaryInformationParser.SummaryLock)
+      {
+        if (SummaryInformationParser.AvailableSummaries == null)
+          SummaryInformationParser.AvailableSummaries = new List<string>();
+        SummaryInformationParser.AvailableSummaries.Add(name);
+      }
     }
 
     /// <summary>
@@ -55,7 +60,10 @@ namespace Whoop.Summarisation
       {
         file.WriteLine("<available_summaries>");
 
-        foreach (var str in SummaryInformationParser.AvailableSummaries)
+        // Summaries can be registered concurrently, so they are written in the
+        // order of the entry points to keep the file stable
+        foreach (var str in SummaryInformationParser.AvailableSummaries.OrderBy(val =>
+          DeviceDriver.EntryPoints.FindIndex(ep => ep.Name.Equals(val))))
         {
           file.WriteLine(str);
         }
@@ -23,14 +23,92 @@ namespace Whoop
     private string File;
     private string Extension;
 
+    private Dictionary<string, Program> ParsedPrograms;
+
     public AnalysisContextParser(string file, string ext)
     {
       this.File = file;
       this.Extension = ext;
+      this.ParsedPrograms = new Dictionary<string, Program>();
     }
 
     public bool TryParseNew(ref AnalysisContext ac, List<string> additional = null)
     {
+      Program program = null;
+      ResolutionContext rc = null;
+
+      if (!this.TryParseProgram(additional, out program, out rc))
+        return false;
+
+      ac = new AnalysisContext(program, rc);
+      if (ac == null)
+        throw new OutcomeException(Outcome.ParsingError, "Cannot create the analysis context of " + this.File + ".");
+
+      return true;
+    }
+
+    /// <summary>
+    /// Parses, resolves and type checks the requested files only the first time
+    /// they are requested. Every call returns a new analysis context that holds
+    /// a deep copy of the cached program.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="ac">AnalysisContext</param>
+    /// <param name="additional">Additional files</param>
+    public bool TryDuplicateNew(ref AnalysisContext ac, List<string> additional = null)
+    {
+      string key = additional == null ? "" : string.Join(";", additional);
+
+      Program program = null;
+      ResolutionContext rc = null;
+
+      if (!this.ParsedPrograms.TryGetValue(key, out program))
+      {
+        if (!this.TryParseProgram(additional, out program, out rc))
+          return false;
+        this.ParsedPrograms.Add(key, program);
+      }
+
+      ac = new AnalysisContext(ProgramDuplicator.Duplicate(program, out rc), rc);
+      if (ac == null)
+        throw new OutcomeException(Outcome.ParsingError, "Cannot create the analysis context of " + this.File + ".");
+
+      return true;
+    }
+
+    /// <summary>
+    /// Parses the given sets of additional files into a single analysis context.
+    /// The sets may share files, and declarations that appear in more than one of
+    /// the files are kept only once. The files cannot be merged if two of them
+    /// declare the same name differently.
+    /// </summary>
+    /// <returns>Boolean value</returns>
+    /// <param name="ac">AnalysisContext</param>
+    /// <param name="additional">Sets of additional files</param>
+    public bool TryParseMerged(ref AnalysisContext ac, List<List<string>> additional)
+    {
+      Contract.Requires(additional != null);
+      var files = additional.SelectMany(val => val).Distinct().ToList();
+
+      Program program = null;
+      ResolutionContext rc = null;
+
+      if (!this.TryParseProgram(files, out program, out rc, true))
+        return false;
+
+      ac = new AnalysisContext(program, rc);
+      if (ac == null)
+        throw new OutcomeException(Outcome.ParsingError, "Cannot create the analysis context of " + this.File + ".");
+
+      return true;
+    }
+
+    private bool TryParseProgram(List<string> additional, out Program program, out ResolutionContext rc,
+      bool merge = false)
+    {
+      program = null;
+      rc = null;
+
       List<string> filesToParse = new List<string>();
       filesToParse.Add(WhoopCommandLineOptions.Get().WhoopDeclFile);
 
@@ -54,10 +132,13 @@ namespace Whoop
         filesToParse.Add(file);
       }
 
-      Program program = ExecutionEngine.ParseBoogieProgram(filesToParse, false);
+      program = ExecutionEngine.ParseBoogieProgram(filesToParse, false);
       if (program == null) return false;
 
-      ResolutionContext rc = new ResolutionContext(null);
+      if (merge && !this.TryRemoveDuplicateDeclarations(program))
+        return false;
+
+      rc = new ResolutionContext(null);
       program.Resolve(rc);
       if (rc.ErrorCount != 0)
       {
@@ -72,10 +153,46 @@ namespace Whoop
         return false;
       }
 
-      ac = new AnalysisContext(program, rc);
-      if (ac == null) Environment.Exit((int)Outcome.ParsingError);
-
       return true;
     }
+
+    private bool TryRemoveDuplicateDeclarations(Program program)
+    {
+      var seen = new Dictionary<string, string>();
+      bool isConsistent = true;
+
+      program.RemoveTopLevelDeclarations(val => {
+        string key = null;
+        if (val is NamedDeclaration)
+          key = val.GetType().Name + "::" + (val as NamedDeclaration).Name;
+        else if (val is Axiom)
+          key = "Axiom::" + (val as Axiom).Expr.ToString();
+        if (key == null)
+          return false;
+
+        string text = this.Print(val);
+        string kept = null;
+        if (!seen.TryGetValue(key, out kept))
+        {
+          seen.Add(key, text);
+          return false;
+        }
+
+        if (!kept.Equals(text))
+          isConsistent = false;
+        return true;
+      });
+
+      return isConsistent;
+    }
+
+    private string Print(Declaration decl)
+    {
+      using (var writer = new StringWriter())
+      {
+        decl.Emit(new TokenTextWriter(writer), 0);
+        return writer.ToString();
+      }
+    }
   }
 }
@@ -0,0 +1,130 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Contracts;
+using System.Linq;
+using Microsoft.Boogie;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Creates deep copies of resolved and type checked programs, without having
+  /// to parse, resolve and type check them again.
+  /// </summary>
+  internal sealed class ProgramDuplicator : StandardVisitor
+  {
+    private Dictionary<Declaration, Declaration> DeclarationMap;
+    private Dictionary<Variable, Variable> VariableMap;
+    private HashSet<Declaration> Duplicates;
+
+    private ProgramDuplicator(Dictionary<Declaration, Declaration> declarationMap)
+    {
+      this.DeclarationMap = declarationMap;
+      this.VariableMap = new Dictionary<Variable, Variable>();
+      this.Duplicates = new HashSet<Declaration>(declarationMap.Values);
+    }
+
+    /// <summary>
+    /// Duplicates the given resolved program.
+    /// </summary>
+    /// <returns>Program</returns>
+    /// <param name="program">Program</param>
+    /// <param name="rc">Resolution context of the duplicated program</param>
+    public static Program Duplicate(Program program, out ResolutionContext rc)
+    {
+      Contract.Requires(program != null);
+      var duplicate = new Duplicator().VisitProgram(program);
+
+      var originalDecls = program.TopLevelDeclarations.ToList();
+      var duplicateDecls = duplicate.TopLevelDeclarations.ToList();
+      Contract.Assert(originalDecls.Count == duplicateDecls.Count);
+
+      // The duplicator shares formals, locals and bound variables with the original
+      // program and does not rebind references to top level declarations, so both
+      // are fixed up here.
+      var declarationMap = new Dictionary<Declaration, Declaration>();
+      for (int idx = 0; idx < originalDecls.Count; idx++)
+      {
+        Contract.Assert(originalDecls[idx].GetType() == duplicateDecls[idx].GetType());
+        declarationMap.Add(originalDecls[idx], duplicateDecls[idx]);
+      }
+
+      new ProgramDuplicator(declarationMap).Visit(duplicate);
+
+      rc = new ResolutionContext(null);
+      foreach (var decl in duplicateDecls)
+        decl.Register(rc);
+
+      return duplicate;
+    }
+
+    public override List<Variable> VisitVariableSeq(List<Variable> variableSeq)
+    {
+      var duplicateSeq = new List<Variable>();
+      foreach (var v in variableSeq)
+        duplicateSeq.Add(this.DuplicateVariable(v));
+      return base.VisitVariableSeq(duplicateSeq);
+    }
+
+    public override Expr VisitIdentifierExpr(IdentifierExpr node)
+    {
+      if (node.Decl != null)
+        node.Decl = this.DuplicateVariable(node.Decl);
+      return base.VisitIdentifierExpr(node);
+    }
+
+    public override Expr VisitNAryExpr(NAryExpr node)
+    {
+      var call = node.Fun as FunctionCall;
+      Declaration decl = null;
+      if (call != null && call.Func != null && this.DeclarationMap.TryGetValue(call.Func, out decl))
+        node.Fun = new FunctionCall(decl as Function);
+      return base.VisitNAryExpr(node);
+    }
+
+    public override Cmd VisitCallCmd(CallCmd node)
+    {
+      Declaration decl = null;
+      if (node.Proc != null && this.DeclarationMap.TryGetValue(node.Proc, out decl))
+        node.Proc = decl as Procedure;
+      return base.VisitCallCmd(node);
+    }
+
+    public override Implementation VisitImplementation(Implementation node)
+    {
+      Declaration decl = null;
+      if (node.Proc != null && this.DeclarationMap.TryGetValue(node.Proc, out decl))
+        node.Proc = decl as Procedure;
+      return base.VisitImplementation(node);
+    }
+
+    private Variable DuplicateVariable(Variable v)
+    {
+      Declaration decl = null;
+      if (this.DeclarationMap.TryGetValue(v, out decl))
+        return decl as Variable;
+      if (this.Duplicates.Contains(v))
+        return v;
+
+      Variable duplicate = null;
+      if (!this.VariableMap.TryGetValue(v, out duplicate))
+      {
+        duplicate = (Variable)new Duplicator().Visit(v);
+        this.VariableMap.Add(v, duplicate);
+        this.Duplicates.Add(duplicate);
+      }
+
+      return duplicate;
+    }
+  }
+}
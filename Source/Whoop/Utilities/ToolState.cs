@@ -0,0 +1,48 @@
+﻿// ===-----------------------------------------------------------------------==//
+//
+//                 Whoop - a Verifier for Device Drivers
+//
+//  Copyright (c) 2013-2014 Pantazis Deligiannis (p.deligiannis@imperial.ac.uk)
+//
+//  This file is distributed under the Microsoft Public License.  See
+//  LICENSE.TXT for details.
+//
+// ===----------------------------------------------------------------------===//
+
+using System;
+using System.Threading;
+
+using Whoop.Domain.Drivers;
+using Whoop.Instrumentation;
+using Whoop.Summarisation;
+
+namespace Whoop
+{
+  /// <summary>
+  /// Resets the static state that the Whoop tools build up during a run, so that
+  /// several runs can take place in the same process.
+  /// </summary>
+  public static class ToolState
+  {
+    /// <summary>
+    /// Cancelled when the run is no longer wanted, for example because the client
+    /// of a daemon job has gone away. The tools check it between entry points and
+    /// between pairs.
+    /// </summary>
+    public static CancellationToken Cancellation = CancellationToken.None;
+
+    /// <summary>
+    /// Resets the static state for a new run that stops once the given token is
+    /// cancelled.
+    /// </summary>
+    /// <param name="cancellation">Cancellation token</param>
+    public static void Reset(CancellationToken cancellation)
+    {
+      ToolState.Cancellation = cancellation;
+      AnalysisSession.Start();
+      DeviceDriver.Reset();
+      SummaryInformationParser.AvailableSummaries = null;
+      YieldInstrumentation.ResetYieldCounter();
+    }
+  }
+}
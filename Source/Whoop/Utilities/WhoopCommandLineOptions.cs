@@ -20,7 +20,10 @@ namespace Whoop
 
     public string OriginalFile = "";
     public string WhoopDeclFile = "";
+    public string KernelRulesFile = "";
     public string AnalyseOnly = "";
+    public string IncrementalKey = "";
+    public string[] Arguments = new string[0];
 
     public int InliningBound = 0;
     public int EntryPointFunctionCallComplexity = 150;
@@ -28,6 +31,7 @@ namespace Whoop
     public bool CheckInParamAliasing = false;
     public bool MergeExistentials = true;
     public bool OptimiseHeavyAsyncCalls = true;
+    public bool BitvectorLocksets = false;
 
     public bool FindBugs = false;
     public bool YieldAll = false;
@@ -40,6 +44,8 @@ namespace Whoop
     public bool PrintPairs = false;
     public bool OnlyRaceChecking = false;
     public bool SkipInference = false;
+    public bool Incremental = false;
+    public bool Pipeline = false;
     public bool InlineHelperFunctions = false;
     public bool DebugWhoop = false;
     public bool ShowErrorModel = false;
@@ -77,6 +83,15 @@ namespace Whoop
         return true;
       }
 
+      if (option == "kernelRules")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.KernelRulesFile = ps.args[ps.i];
+        }
+        return true;
+      }
+
       if (option == "analyseOnly")
       {
         if (ps.ConfirmArgumentCount(1))
@@ -86,6 +101,15 @@ namespace Whoop
         return true;
       }
 
+      if (option == "incrementalKey")
+      {
+        if (ps.ConfirmArgumentCount(1))
+        {
+          this.IncrementalKey = ps.args[ps.i];
+        }
+        return true;
+      }
+
       if (option == "inlineBound")
       {
         if (ps.ConfirmArgumentCount(1))
@@ -161,12 +185,30 @@ namespace Whoop
         return true;
       }
 
+      if (option == "bitvectorLocksets")
+      {
+        this.BitvectorLocksets = true;
+        return true;
+      }
+
       if (option == "skipInference")
       {
         this.SkipInference = true;
         return true;
       }
 
+      if (option == "incremental")
+      {
+        this.Incremental = true;
+        return true;
+      }
+
+      if (option == "pipeline")
+      {
+        this.Pipeline = true;
+        return true;
+      }
+
       if (option == "printPairs")
       {
         this.PrintPairs = true;
@@ -12,6 +12,10 @@ import pprint
 import fnmatch
 import shutil
 import re
+import socket
+import Queue
+import hashlib
+import tempfile
 
 VERSION = '0.7'
 
@@ -105,6 +109,11 @@ cleanUpHandler = BatchCaller()
 Tools = [ "chauffeur", "clang", "smack", "whoopEngine", "whoopCruncher", "whoopRaceChecker", "corral" ]
 Timing = { }
 
+""" Memory (in MB) that a single Corral instance is assumed to need when
+sizing the Corral job pool.
+"""
+corralJobMemory = 1024
+
 """ WindowsError is not defined on UNIX
 systems, this works around that.
 """
@@ -148,6 +157,7 @@ class DefaultCmdLineOptions(object):
     self.whoopCruncherOptions = [ ]
     self.whoopRaceCheckerOptions = [ "/nologo", "/typeEncoding:m", "/mv:-", "/doNotUseLabels", "/enhancedErrorMessages:1" ]
     self.corralOptions = [ ]
+    self.corralJobs = 0
     self.includes = []
     self.defines = clangCoreDefines
     self.analyseOnly = ""
@@ -170,6 +180,7 @@ class DefaultCmdLineOptions(object):
     self.noHeavyAsyncCallsOptimisation = False
     self.checkInParamAliasing = False
     self.noExistentialOpts = False
+    self.bitvectorLocksets = False
     self.useOtherModel = False
     self.verbose = False
     self.silent = False
@@ -181,6 +192,10 @@ class DefaultCmdLineOptions(object):
     self.timeCSVLabel = None
     self.timePasses = None
     self.componentTimeout = 0
+    self.cacheDir = None
+    self.incremental = False
+    self.pipeline = False
+    self.daemonSocket = findtools.whoopBinDir + os.sep + "WhoopDaemon.sock"
     self.solver = "z3"
     self.logic = "AUFLIRA"
     self.stopAtRe = False
@@ -224,6 +239,20 @@ def showHelpAndExit():
                             A timeout of 0 disables the timeout. The default is {componentTimeout} seconds.
     --verbose               Show commands to run and use verbose output.
     --time                  Show timing information.
+    --incremental           Only verify the entry point pairs that are affected by changes since
+                            the previous incremental run, and reuse the stored outcomes of the
+                            remaining pairs. Cannot be combined with --find-bugs.
+    --pipeline              Run the Whoop engine, cruncher and race checker at the same time, so that
+                            each entry point and pair moves on to the next stage as soon as it is ready.
+                            Each of these tools may run for the timeout after the previous one finished.
+    --cache-dir=X           Store the chauffeur, clang and SMACK artifacts in the cache directory X,
+                            and reuse them when the driver, the headers, the options and the tools
+                            have not changed.
+    --daemon-socket=X       Run the Whoop tools on the Whoop daemon listening on the socket X, instead
+                            of starting them afresh. The daemon is started with 'mono WhoopDaemon.exe'
+                            and by default listens on WhoopDaemon.sock in the Whoop binaries directory.
+                            The tools are run directly if no daemon is listening.
+    --no-daemon             Always run the Whoop tools directly.
     -V, --version           Show version information.
 
   ADVANCED OPTIONS:
@@ -234,8 +263,13 @@ def showHelpAndExit():
     --k=X                   Use Corral's /k.
     --recursion-bound=X     Use Corral's /recursionBound.
     --static-loop-bound=X   Use Corral's /maxStaticLoopBound.
+    --corral-jobs=X         Run up to X Corral instances in parallel. The default of 0 picks
+                            a value based on the available cores and memory.
     --inparam-aliasing      Disable assumption that inparams cannot alias.
     --no-existential-opts   Do not perform existential optimisations.
+    --bitvector-locksets    Encode each lockset as a single bitvector with one bit per lock.
+                            With CVC4 this needs a logic with bitvectors, so the logic
+                            defaults to ALL_SUPPORTED and AUFLIRA is rejected.
     --analyse-only=X        Specify entry point to be analysed. All others are skipped.
     --no-infer              Turn off invariant inference.
     --skip-non-racy-pairs   Skip race free pairs from Corral analysis.
@@ -364,6 +398,8 @@ def processGeneralOptions(opts, args):
       CommandLineOptions.checkInParamAliasing = True
     if o == "--no-existential-opts":
       CommandLineOptions.noExistentialOpts = True
+    if o == "--bitvector-locksets":
+      CommandLineOptions.bitvectorLocksets = True
     if o == "--other-model":
       CommandLineOptions.useOtherModel = True
     if o == "--keep-temps":
@@ -377,6 +413,16 @@ def processGeneralOptions(opts, args):
       CommandLineOptions.timeCSVLabel = a
     if o == "--time-passes":
       CommandLineOptions.timePasses = True
+    if o == "--incremental":
+      CommandLineOptions.incremental = True
+    if o == "--pipeline":
+      CommandLineOptions.pipeline = True
+    if o == "--daemon-socket":
+      CommandLineOptions.daemonSocket = os.path.realpath(os.path.expanduser(a))
+    if o == "--no-daemon":
+      CommandLineOptions.daemonSocket = None
+    if o == "--cache-dir":
+      CommandLineOptions.cacheDir = os.path.realpath(os.path.expanduser(a))
     if o == "--clang-opt":
       CommandLineOptions.clangOptions += str(a).split(" ")
     if o == "--smack-opt":
@@ -482,6 +528,19 @@ def processGeneralOptions(opts, args):
           raise ValueError
       except ValueError as e:
           raise ReportAndExit(ErrorCodes.COMMAND_LINE_ERROR, "Invalid static loop bound \"" + a + "\"")
+    if o == "--corral-jobs":
+      try:
+        CommandLineOptions.corralJobs = int(a)
+        if CommandLineOptions.corralJobs < 0:
+          raise ValueError
+      except ValueError as e:
+          raise ReportAndExit(ErrorCodes.COMMAND_LINE_ERROR, "Invalid number of Corral jobs \"" + a + "\"")
+
+  # Bitvector locksets need a logic with bitvectors, which AUFLIRA is not
+  if CommandLineOptions.bitvectorLocksets and CommandLineOptions.solver == "cvc4" and CommandLineOptions.logic == "AUFLIRA":
+    if any(o == "--logic" for o, a in opts):
+      raise ReportAndExit(ErrorCodes.COMMAND_LINE_ERROR, "--bitvector-locksets cannot be used with --logic=AUFLIRA")
+    CommandLineOptions.logic = "ALL_SUPPORTED"
 
 """ This class is used by run() to implement a timeout for tools. It
 uses threading.Timer to implement the timeout and provides a method
@@ -493,12 +552,7 @@ class ToolWatcher(object):
     if self.popenObject.poll() == None :
       # Program is still running, let's kill it
       self.__killed=True
-      if psutilPresent:
-        children = psutil.Process(self.popenObject.pid).get_children(True)
-      self.popenObject.terminate()
-      if psutilPresent:
-        for child in children:
-          child.terminate()
+      terminate(self.popenObject)
 
   def __init__(self,popenObject,timeout):
     self.timeout = timeout
@@ -513,6 +567,16 @@ class ToolWatcher(object):
   def cancelTimeout(self):
     self.timer.cancel()
 
+""" Terminate a running process together with its children.
+"""
+def terminate(popenObject):
+  if psutilPresent:
+    children = psutil.Process(popenObject.pid).get_children(True)
+  popenObject.terminate()
+  if psutilPresent:
+    for child in children:
+      child.terminate()
+
 """ Run a command with an optional timeout. A timeout
 of zero implies no timeout.
 """
@@ -550,6 +614,68 @@ def run(command, timeout=0):
 
   return stdout, proc.returncode
 
+""" Check if the output of the tools is returned to the caller, rather
+than shown on the console, as done by run().
+"""
+def isOutputPiped():
+  return CommandLineOptions.silent or (not CommandLineOptions.verbose and __name__ != '__main__')
+
+""" The Whoop tools that can run on the Whoop daemon, together with
+the name that the daemon knows them by.
+"""
+DaemonTools = { "whoopEngine": "engine",
+                "whoopCruncher": "cruncher",
+                "whoopRaceChecker": "raceChecker" }
+
+""" Check if a Whoop daemon might be listening.
+"""
+def daemonIsAvailable():
+  return (CommandLineOptions.daemonSocket != None and hasattr(socket, "AF_UNIX") and
+          os.path.exists(CommandLineOptions.daemonSocket))
+
+""" Run a Whoop tool command on the Whoop daemon, which keeps the tools
+loaded between invocations. The output is handled as in run(). Returns
+None if the daemon cannot be reached or stops before finishing the job,
+in which case the caller should run the command directly.
+"""
+def runOnDaemon(tool, command, timeout=0):
+  exe = [ idx for idx, arg in enumerate(command) if arg.endswith(".exe") ][0]
+  args = command[exe + 1:]
+  request = "\n".join([ tool, os.getcwd(), str(len(args)) ] + args) + "\n"
+  if CommandLineOptions.verbose:
+    print(" ".join(command) + " (on the Whoop daemon)")
+
+  chunks = [ ]
+  client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  try:
+    client.connect(CommandLineOptions.daemonSocket)
+    client.sendall(request)
+    client.settimeout(timeout if timeout > 0 else None)
+    while True:
+      chunk = client.recv(65536)
+      if not chunk: break
+      chunks.append(chunk)
+  except socket.timeout:
+    raise Timeout
+  except socket.error:
+    return None
+  except KeyboardInterrupt:
+    raise ReportAndExit(ErrorCodes.CTRL_C)
+  finally:
+    client.close()
+
+  reply = "".join(chunks)
+  if not "\n" in reply:
+    return None
+  returnCode, stdout = reply.split("\n", 1)
+
+  if not isOutputPiped():
+    sys.stdout.write(stdout)
+    sys.stdout.flush()
+    stdout = None
+
+  return stdout, int(returnCode)
+
 """ Run a tool. If the timeout is set to 0 then there will be no
 timeout.
 """
@@ -563,14 +689,18 @@ def runTool(ToolName, Command, ErrorCode, timeout=0):
       remainingTime = timeout - int(Timing[ToolName])
       if remainingTime < 1:
         remainingTime = 1
-    stdout, returnCode = run(Command, remainingTime)
+    result = None
+    if ToolName in DaemonTools and daemonIsAvailable():
+      result = runOnDaemon(DaemonTools[ToolName], Command, remainingTime)
+    if result == None:
+      result = run(Command, remainingTime)
+    stdout, returnCode = result
     end = timeit.default_timer()
   except Timeout:
-    if CommandLineOptions.time:
-      if Timing.has_key(ToolName):
-        Timing[ToolName] = Timing[ToolName] + remainingTime
-      else:
-        Timing[ToolName] = timeout
+    if Timing.has_key(ToolName):
+      Timing[ToolName] = Timing[ToolName] + remainingTime
+    else:
+      Timing[ToolName] = timeout
     raise ReportAndExit(ErrorCodes.TIMEOUT, ToolName + " timed out. " + \
                         "Use --timeout=N with N > " + str(timeout)    + \
                         " to increase timeout, or --timeout=0 to "    + \
@@ -579,32 +709,250 @@ def runTool(ToolName, Command, ErrorCode, timeout=0):
     raise ReportAndExit(ErrorCode, "While invoking " + ToolName       + \
                         ": " + str(e) + "\nWith command line args:\n" + \
                         pprint.pformat(Command))
-  if CommandLineOptions.time:
-    if Timing.has_key(ToolName):
-      Timing[ToolName] = Timing[ToolName] + end-start
-    else:
-      Timing[ToolName] = end-start
+  if Timing.has_key(ToolName):
+    Timing[ToolName] = Timing[ToolName] + end-start
+  else:
+    Timing[ToolName] = end-start
   if returnCode != ErrorCodes.SUCCESS:
     if not (CommandLineOptions.findBugs and ToolName == "whoopRaceChecker"):
       if CommandLineOptions.silent and stdout: print(stdout, file=sys.stderr)
       raise ReportAndExit(ErrorCode, stdout)
 
+""" Check if the Whoop engine, cruncher and race checker can run as a
+pipeline. This needs all three of them to run to completion.
+"""
+def usePipeline():
+  if not CommandLineOptions.pipeline:
+    return False
+  if (CommandLineOptions.skip["engine"] or CommandLineOptions.skip["raceChecker"] or
+      CommandLineOptions.stopAtEngine or CommandLineOptions.stopAtCruncher):
+    showWarning("--pipeline is ignored, as it needs the Whoop engine, cruncher and race checker to run.")
+    return False
+  return True
+
+""" Run a pipeline of tools at the same time. Each tool announces the entry
+points and pairs that it has finished in a .pipeline.info file, and the next
+tool picks them up from there, so the stages overlap. The stages are given as
+(ToolName, Command, ErrorCode) tuples. Each tool may run for the timeout after
+the tool before it has finished, and its timing is the time that it ran on
+its own. The output of the tools is shown in stage order once they finish.
+If a tool fails, the other tools are stopped.
+"""
+def runPipeline(stages, timeout=0):
+  processes = [ ]
+  outputs = { }
+
+  def collect(ToolName, proc):
+    outputs[ToolName] = proc.communicate()[0]
+
+  def showOutputs(ToolNames):
+    if isOutputPiped(): return
+    for ToolName in ToolNames:
+      if outputs.get(ToolName): print(outputs[ToolName], end='')
+
+  def fail(ToolName, returnCode, ErrorCode):
+    previous = [ stage[0] for stage in stages ]
+    showOutputs(previous[:previous.index(ToolName)])
+    stdout = outputs.get(ToolName)
+    if CommandLineOptions.silent and stdout: print(stdout, file=sys.stderr)
+    raise ReportAndExit(ErrorCode, stdout)
+
+  start = timeit.default_timer()
+  try:
+    for ToolName, Command, ErrorCode in stages:
+      assert ToolName in Tools
+      verbose("Running " + ToolName)
+      if CommandLineOptions.verbose:
+        print(" ".join(Command))
+      try:
+        proc = subprocess.Popen(Command, bufsize=0, stdin=subprocess.PIPE,
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+      except (OSError, WindowsError) as e:
+        raise ReportAndExit(ErrorCode, "While invoking " + ToolName       + \
+                            ": " + str(e) + "\nWith command line args:\n" + \
+                            pprint.pformat(Command))
+      reader = threading.Thread(target=collect, args=(ToolName, proc))
+      reader.daemon = True
+      reader.start()
+      processes.append((ToolName, proc, reader, ErrorCode))
+
+    stageStart = start
+    for ToolName, proc, reader, ErrorCode in processes:
+      while reader.is_alive():
+        for otherName, other, otherReader, otherErrorCode in processes:
+          if other.poll() in (None, ErrorCodes.SUCCESS) or otherReader.is_alive(): continue
+          if CommandLineOptions.findBugs and otherName == "whoopRaceChecker": continue
+          fail(otherName, other.returncode, otherErrorCode)
+        if timeout > 0 and timeit.default_timer() - stageStart > timeout:
+          Timing[ToolName] = Timing.get(ToolName, 0) + timeout
+          raise ReportAndExit(ErrorCodes.TIMEOUT, ToolName + " timed out. " + \
+                              "Use --timeout=N with N > " + str(timeout)    + \
+                              " to increase timeout, or --timeout=0 to "    + \
+                              "disable timeout.")
+        # Poll, as a blocking join cannot be interrupted with Ctrl-C
+        reader.join(0.1)
+
+      end = timeit.default_timer()
+      Timing[ToolName] = Timing.get(ToolName, 0) + end - stageStart
+      stageStart = end
+      if proc.returncode != ErrorCodes.SUCCESS:
+        if not (CommandLineOptions.findBugs and ToolName == "whoopRaceChecker"):
+          fail(ToolName, proc.returncode, ErrorCode)
+  except KeyboardInterrupt:
+    raise ReportAndExit(ErrorCodes.CTRL_C)
+  finally:
+    for ToolName, proc, reader, ErrorCode in processes:
+      if proc.poll() == None:
+        terminate(proc)
+
+  showOutputs([ stage[0] for stage in stages ])
+
+""" Number of Corral instances to run in parallel. Unless given on the
+command line, this is bounded by the number of cores and, if psutil is
+available, by the memory that is currently available.
+"""
+def getCorralJobs():
+  if CommandLineOptions.corralJobs > 0:
+    return CommandLineOptions.corralJobs
+  try:
+    import multiprocessing
+    jobs = multiprocessing.cpu_count()
+  except NotImplementedError:
+    jobs = 1
+  if psutilPresent:
+    try:
+      available = psutil.virtual_memory().available / (1024 * 1024)
+      jobs = min(jobs, available / corralJobMemory)
+    except AttributeError:
+      pass
+  return max(1, jobs)
+
+""" Run Corral on all racy pairs using a pool of parallel Corral instances.
+All instances share one deadline: the component timeout, extended by the
+time that the race checker did not use from its own timeout. Results are
+reported in the order in which the instances finish.
+"""
 def runCorral(filename):
-    directory = os.path.dirname(os.path.realpath(filename))
-    inputFile = os.path.splitext(os.path.basename(filename))[0]
-    counter = 0
-    for file in os.listdir(directory):
-      if fnmatch.fnmatch(file, inputFile + '_check_racy_*.bpl'):
-        runTool("corral",
-                (["mono"] if os.name == "posix" else []) +
-                [findtools.corralBinDir + "/corral.exe"] +
-                CommandLineOptions.corralOptions + [ directory + os.sep + file ],
-                ErrorCodes.CORRAL_ERROR,
-                CommandLineOptions.componentTimeout)
-        counter += 1
-        if CommandLineOptions.showCorralStats:
-          print("Pairs analysed so far: " + str(counter))
-          print("Time elapsed so far: " + str(Timing["corral"]))
+  directory = os.path.dirname(os.path.realpath(filename))
+  inputFile = os.path.splitext(os.path.basename(filename))[0]
+  files = sorted([ directory + os.sep + file for file in os.listdir(directory)
+                   if fnmatch.fnmatch(file, inputFile + '_check_racy_*.bpl') ])
+  if len(files) == 0:
+    return
+
+  verbose("Running corral")
+  timeout = CommandLineOptions.componentTimeout
+  start = timeit.default_timer()
+  deadline = None
+  if timeout > 0:
+    deadline = start + timeout
+    if Timing.has_key("whoopRaceChecker"):
+      deadline += max(0, timeout - int(Timing["whoopRaceChecker"]))
+
+  pending = Queue.Queue()
+  for file in files:
+    pending.put(file)
+  results = Queue.Queue()
+  running = set()
+  runningLock = threading.Lock()
+  stopped = threading.Event()
+
+  def runInstance(file):
+    command = ((["mono"] if os.name == "posix" else []) +
+               [findtools.corralBinDir + "/corral.exe"] +
+               CommandLineOptions.corralOptions + [ file ])
+    if CommandLineOptions.verbose:
+      print(" ".join(command))
+
+    remainingTime = 0
+    if deadline != None:
+      remainingTime = deadline - timeit.default_timer()
+      if remainingTime <= 0:
+        raise Timeout
+
+    with runningLock:
+      if stopped.is_set():
+        return None, None
+      proc = subprocess.Popen(command, bufsize=0, stdin=subprocess.PIPE,
+                              stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+      running.add(proc)
+    killer = None
+    if remainingTime > 0:
+      killer = ToolWatcher(proc, remainingTime)
+    try:
+      stdout, stderr = proc.communicate()
+      if killer != None and killer.timeOutOccured():
+        raise Timeout
+    finally:
+      if killer != None:
+        killer.cancelTimeout()
+      with runningLock:
+        running.discard(proc)
+
+    return stdout, proc.returncode
+
+  def worker():
+    while not stopped.is_set():
+      try:
+        file = pending.get_nowait()
+      except Queue.Empty:
+        return
+      try:
+        stdout, returnCode = runInstance(file)
+        results.put((file, stdout, returnCode, None))
+      except Timeout:
+        results.put((file, None, None, Timeout()))
+      except Exception as e:
+        # Every file must post a result, or the loop below waits for it forever
+        results.put((file, None, None, e))
+
+  workers = [ threading.Thread(target=worker) for i in range(min(getCorralJobs(), len(files))) ]
+  for thread in workers:
+    thread.daemon = True
+    thread.start()
+
+  counter = 0
+  try:
+    while counter < len(files):
+      try:
+        # Poll, as a blocking get cannot be interrupted with Ctrl-C
+        file, stdout, returnCode, error = results.get(True, 1)
+      except Queue.Empty:
+        continue
+      counter += 1
+
+      if isinstance(error, Timeout):
+        raise ReportAndExit(ErrorCodes.TIMEOUT, "corral timed out. " + \
+                            "Use --timeout=N with N > " + str(timeout)   + \
+                            " to increase timeout, or --timeout=0 to "   + \
+                            "disable timeout.")
+      elif error != None:
+        raise ReportAndExit(ErrorCodes.CORRAL_ERROR, "While invoking corral"  + \
+                            " on " + file + ": " + str(error))
+
+      if returnCode != ErrorCodes.SUCCESS:
+        if stdout: print(stdout, file=sys.stderr)
+        raise ReportAndExit(ErrorCodes.CORRAL_ERROR, "corral failed on " + file)
+      if stdout and not CommandLineOptions.silent:
+        print(stdout, end='')
+
+      if CommandLineOptions.showCorralStats:
+        print("Pairs analysed so far: " + str(counter))
+        print("Time elapsed so far: " + str(timeit.default_timer() - start))
+  except KeyboardInterrupt:
+    raise ReportAndExit(ErrorCodes.CTRL_C)
+  finally:
+    stopped.set()
+    with runningLock:
+      for proc in running:
+        if proc.poll() == None:
+          terminate(proc)
+    for thread in workers:
+      thread.join()
+    if Timing.has_key("corral"):
+      Timing["corral"] = Timing["corral"] + timeit.default_timer() - start
+    else:
+      Timing["corral"] = timeit.default_timer() - start
 
 def addInline(match, info):
   foundit = False
@@ -630,6 +978,94 @@ def processBPL(file, info):
     f.seek(0)
     f.write(bpl)
 
+""" The artifacts of the front-end stages (chauffeur, clang and SMACK) that
+are kept in the front-end cache, given by their filename suffix.
+"""
+FrontEndArtifacts = [ ".re.c", ".info", ".fp.info", ".bc", ".bpl" ]
+
+def hashFile(sha, file):
+  with open(file, "rb") as f:
+    for chunk in iter(lambda: f.read(65536), b''):
+      sha.update(chunk)
+
+""" Compute the front-end cache key of a driver. The key covers the driver
+source, the headers next to it and in the include directories, the options
+passed to the front-end tools and the front-end tool binaries.
+"""
+def getFrontEndCacheKey(sourceFile, tools):
+  sha = hashlib.sha1()
+  def hashString(string):
+    sha.update(string + '\0')
+
+  hashString(VERSION)
+  hashFile(sha, os.path.realpath(__file__))
+  hashFile(sha, sourceFile)
+
+  for option in (CommandLineOptions.chauffeurOptions + CommandLineOptions.clangOptions +
+                 CommandLineOptions.smackOptions + CommandLineOptions.includes +
+                 CommandLineOptions.defines):
+    hashString(option)
+
+  # Use size and modification time as the version of a tool, as hashing
+  # the binaries on every invocation would be too expensive
+  for tool in tools:
+    hashString(tool)
+    if os.path.exists(tool):
+      stat = os.stat(tool)
+      hashString(str(stat.st_size))
+      hashString(str(stat.st_mtime))
+
+  headers = set()
+  sourceDir = os.path.dirname(os.path.realpath(sourceFile))
+  for file in os.listdir(sourceDir):
+    if file.endswith(".h"):
+      headers.add(os.path.join(sourceDir, file))
+  for include in CommandLineOptions.includes:
+    for root, dirs, files in os.walk(include):
+      for file in files:
+        headers.add(os.path.realpath(os.path.join(root, file)))
+  for header in sorted(headers):
+    hashString(header)
+    hashFile(sha, header)
+
+  return sha.hexdigest()
+
+""" Copy the cached front-end artifacts of the given key next to the
+driver. Returns False if the key is not in the cache.
+"""
+def restoreFrontEndArtifacts(key, filename):
+  entry = os.path.join(CommandLineOptions.cacheDir, key)
+  if not os.path.isdir(entry):
+    return False
+  for suffix in FrontEndArtifacts:
+    cached = os.path.join(entry, suffix[1:])
+    if os.path.exists(cached):
+      shutil.copyfile(cached, filename + suffix)
+  return True
+
+""" Store the front-end artifacts of the driver under the given key. The
+artifacts are staged in a temporary directory that is then renamed, so
+concurrent invocations never observe a partial cache entry.
+"""
+def storeFrontEndArtifacts(key, filename):
+  entry = os.path.join(CommandLineOptions.cacheDir, key)
+  if os.path.isdir(entry):
+    return
+  staging = None
+  try:
+    if not os.path.isdir(CommandLineOptions.cacheDir):
+      os.makedirs(CommandLineOptions.cacheDir)
+    staging = tempfile.mkdtemp(dir=CommandLineOptions.cacheDir)
+    for suffix in FrontEndArtifacts:
+      if os.path.exists(filename + suffix):
+        shutil.copyfile(filename + suffix, os.path.join(staging, suffix[1:]))
+    os.rename(staging, entry)
+  except (OSError, IOError) as e:
+    # The cache is an optimisation, so failing to populate it is not an error
+    verbose("Could not store front-end artifacts in cache: " + str(e))
+    if staging != None:
+      shutil.rmtree(staging, True)
+
 """ This function should NOT be called directly instead call
 main(). It is assumed that argv has had sys.argv[0] removed.
 """
@@ -641,15 +1077,17 @@ def startToolChain(argv):
     opts, args = getopt.gnu_getopt(argv,'hVD:I:',
              ['help', 'version', 'debug', 'verbose', 'silent',
               'find-bugs', 'only-race-checking', 'only-deadlock-checking',
-              'time', 'time-as-csv=', 'time-passes',
+              'time', 'time-as-csv=', 'time-passes', 'cache-dir=', 'incremental',
+              'daemon-socket=', 'no-daemon', 'pipeline',
               'keep-temps', 'print-pairs',
               'clang-opt=', 'smack-opt=',
               'boogie-opt=', 'timeout=', 'boogie-file=',
               'analyse-only=', 'inline', 'inline-bound=', 'k=', 'recursion-bound=', 'static-loop-bound=',
+              'corral-jobs=',
               'no-infer', 'no-heavy-async-calls-optimisation', 'skip-non-racy-pairs',
               'yield-all', 'yield-coarse', 'yield-no-access', 'yield-race-check',
               'optimize-corral', 'show-corral-stats',
-              'inparam-aliasing', 'no-existential-opts',
+              'inparam-aliasing', 'no-existential-opts', 'bitvector-locksets',
               'gen-smt2', 'solver=', 'logic=', 'other-model',
               'stop-at-re', 'stop-at-bc', 'stop-at-bpl', 'stop-at-engine',
               'stop-at-cruncher', 'stop-at-race-checker',
@@ -675,6 +1113,7 @@ def startToolChain(argv):
   infoFilename = filename + '.info'
   fpFilename = filename + '.fp.info'
   summaryInfoFilename = filename + '.summaries.info'
+  prunedInfoFilename = filename + '.pruned.info'
   smt2Filename = filename + '.smt2'
   if not CommandLineOptions.keepTemps:
     inputFilename = filename + ext
@@ -698,8 +1137,10 @@ def startToolChain(argv):
     if not CommandLineOptions.stopAtBpl: cleanUpHandler.register(DeleteFile, bplFilename)
     if not CommandLineOptions.stopAtEngine: cleanUpHandler.register(DeleteFilesWithPattern, wbplFilename)
     if not CommandLineOptions.stopAtEngine: cleanUpHandler.register(DeleteFile, summaryInfoFilename)
+    if not CommandLineOptions.stopAtEngine: cleanUpHandler.register(DeleteFile, prunedInfoFilename)
     if not CommandLineOptions.stopAtCruncher: cleanUpHandler.register(DeleteFilesWithPattern, "wbpl")
     if not CommandLineOptions.stopAtRaceChecker: cleanUpHandler.register(DeleteFilesWithPattern, "bpl")
+    cleanUpHandler.register(DeleteFilesWithPattern, "pipeline.info")
 
   if CommandLineOptions.useOtherModel:
     global clangCoreIncludes
@@ -725,6 +1166,9 @@ def startToolChain(argv):
   CommandLineOptions.whoopEngineOptions += [ "/whoopDecl:" + findtools.whoopDir + os.sep + "Model" + os.sep + "whoop_decl.bpl" ]
   CommandLineOptions.whoopCruncherOptions += [ "/whoopDecl:" + findtools.whoopDir + os.sep + "Model" + os.sep + "whoop_decl.bpl" ]
   CommandLineOptions.whoopRaceCheckerOptions += [ "/whoopDecl:" + findtools.whoopDir + os.sep + "Model" + os.sep + "whoop_decl.bpl" ]
+  CommandLineOptions.whoopEngineOptions += [ "/kernelRules:" + findtools.whoopDir + os.sep + "Model" + os.sep + "kernel_rules.info" ]
+  CommandLineOptions.whoopCruncherOptions += [ "/kernelRules:" + findtools.whoopDir + os.sep + "Model" + os.sep + "kernel_rules.info" ]
+  CommandLineOptions.whoopRaceCheckerOptions += [ "/kernelRules:" + findtools.whoopDir + os.sep + "Model" + os.sep + "kernel_rules.info" ]
 
   if CommandLineOptions.solver == "cvc4":
     CommandLineOptions.whoopEngineOptions += [ "/proverOpt:SOLVER=cvc4" ]
@@ -791,6 +1235,9 @@ def startToolChain(argv):
   if CommandLineOptions.noHeavyAsyncCallsOptimisation:
     CommandLineOptions.whoopEngineOptions += [ "/noHeavyAsyncCallsOptimisation" ]
 
+  if CommandLineOptions.bitvectorLocksets:
+    CommandLineOptions.whoopEngineOptions += [ "/bitvectorLocksets" ]
+
   if CommandLineOptions.findBugs:
     CommandLineOptions.whoopRaceCheckerOptions += [ "/findBugs" ]
   if CommandLineOptions.skipNonRacyPairs:
@@ -814,10 +1261,39 @@ def startToolChain(argv):
 
   CommandLineOptions.whoopCruncherOptions += [ "/contractInfer" ]
 
+  if CommandLineOptions.incremental and CommandLineOptions.findBugs:
+    showWarning("--incremental is ignored when finding bugs")
+  elif CommandLineOptions.incremental:
+    # The engine decides which pairs are affected, so it needs to know about
+    # everything that can change an outcome after it has run
+    incrementalKey = hashlib.sha1()
+    for option in CommandLineOptions.whoopCruncherOptions + CommandLineOptions.whoopRaceCheckerOptions:
+      incrementalKey.update(option + '\0')
+    for tool in [ "WhoopEngine.exe", "WhoopCruncher.exe", "WhoopRaceChecker.exe" ]:
+      tool = findtools.whoopBinDir + os.sep + tool
+      if os.path.exists(tool):
+        incrementalKey.update(str(os.stat(tool).st_mtime) + '\0')
+    CommandLineOptions.whoopEngineOptions += [ "/incremental", "/incrementalKey:" + incrementalKey.hexdigest() ]
+    CommandLineOptions.whoopCruncherOptions += [ "/incremental" ]
+    CommandLineOptions.whoopRaceCheckerOptions += [ "/incremental" ]
+
   CommandLineOptions.whoopEngineOptions += [ bplFilename ]
   CommandLineOptions.whoopCruncherOptions += [ bplFilename ]
   CommandLineOptions.whoopRaceCheckerOptions += [ bplFilename ]
 
+  frontEndCacheKey = None
+  if CommandLineOptions.cacheDir != None and ext == ".c" and not CommandLineOptions.skip["chauffeur"]:
+    frontEndCacheKey = getFrontEndCacheKey(filename + ext,
+                                           [ findtools.chauffeurDir + "/chauffeur",
+                                             findtools.llvmBinDir + "/clang",
+                                             findtools.smackBinDir + "/smack" ])
+    if restoreFrontEndArtifacts(frontEndCacheKey, filename):
+      verbose("Reusing cached front-end artifacts " + frontEndCacheKey)
+      CommandLineOptions.skip["chauffeur"] = True
+      CommandLineOptions.skip["clang"] = True
+      CommandLineOptions.skip["smack"] = True
+      frontEndCacheKey = None
+
   """ RUN CHAUFFEUR """
   if not CommandLineOptions.skip["chauffeur"]:
     runTool("chauffeur",
@@ -848,8 +1324,38 @@ def startToolChain(argv):
             ErrorCodes.SMACK_ERROR,
              CommandLineOptions.componentTimeout)
     processBPL(bplFilename, infoFilename)
+    if frontEndCacheKey != None:
+      storeFrontEndArtifacts(frontEndCacheKey, filename)
   if CommandLineOptions.stopAtBpl: return 0
 
+  """ RUN WHOOP ENGINE, CRUNCHER AND RACE CHECKER AS A PIPELINE """
+  if usePipeline():
+    stages = [ ("whoopEngine",
+                (["mono"] if os.name == "posix" else []) +
+                [findtools.whoopBinDir + "/WhoopEngine.exe"] +
+                CommandLineOptions.whoopEngineOptions + [ "/pipeline" ],
+                ErrorCodes.WHOOP_ERROR) ]
+    if not CommandLineOptions.noInfer:
+      stages += [ ("whoopCruncher",
+                   (["mono"] if os.name == "posix" else []) +
+                   [findtools.whoopBinDir + "/WhoopCruncher.exe"] +
+                   CommandLineOptions.whoopCruncherOptions + [ "/pipeline" ],
+                   ErrorCodes.WHOOP_ERROR) ]
+    stages += [ ("whoopRaceChecker",
+                 (["mono"] if os.name == "posix" else []) +
+                 [findtools.whoopBinDir + "/WhoopRaceChecker.exe"] +
+                 CommandLineOptions.whoopRaceCheckerOptions + [ "/pipeline" ],
+                 ErrorCodes.DRIVER_ERROR) ]
+    # Announcements left over from a previous run must not be picked up
+    for ToolName in [ "engine", "cruncher" ]:
+      try: os.remove(filename + "." + ToolName + ".pipeline.info")
+      except OSError: pass
+    runPipeline(stages, CommandLineOptions.componentTimeout)
+    if CommandLineOptions.stopAtRaceChecker: return 0
+    CommandLineOptions.skip["engine"] = True
+    CommandLineOptions.skip["cruncher"] = True
+    CommandLineOptions.skip["raceChecker"] = True
+
   """ RUN WHOOP ENGINE """
   if not CommandLineOptions.skip["engine"]:
     runTool("whoopEngine",